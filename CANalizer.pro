@@ -8,24 +8,68 @@ lessThan(QT_MAJOR_VERSION, 5) {
     message("Cannot build current CANalizer sources with Qt version $${QT_VERSION}.")
 }
 
-QT       += core gui widgets serialbus
+QT       += core gui widgets serialbus concurrent network
 
 TARGET = CANalizer
 TEMPLATE = app
 
 CONFIG += c++14
 
+LIBS += -lz
+
 SOURCES += main.cpp\
         mainwindow.cpp \
     logmodel.cpp \
     logdialog.cpp \
-    capturedialog.cpp
+    capturedialog.cpp \
+    pipelinestats.cpp \
+    tracer.cpp \
+    canframe.cpp \
+    framereader.cpp \
+    pcapreader.cpp \
+    blfreader.cpp \
+    logfollower.cpp \
+    journal.cpp \
+    correlator.cpp \
+    correlationdialog.cpp \
+    signaldetector.cpp \
+    changeindex.cpp \
+    mergedreader.cpp \
+    canbussource.cpp \
+    remoteprotocol.cpp \
+    captureserver.cpp \
+    remoteclient.cpp \
+    sidecarindex.cpp
 
 HEADERS  += mainwindow.h \
     logmodel.h \
     logdialog.h \
-    capturedialog.h
+    capturedialog.h \
+    pipelinestats.h \
+    tracer.h \
+    canframe.h \
+    framereader.h \
+    pcapreader.h \
+    blfreader.h \
+    logfollower.h \
+    journal.h \
+    correlator.h \
+    correlationdialog.h \
+    signaldetector.h \
+    changeindex.h \
+    mergedreader.h \
+    canbussource.h \
+    remoteprotocol.h \
+    captureserver.h \
+    remoteclient.h \
+    sidecarindex.h
+
+linux {
+    SOURCES += socketcansource.cpp
+    HEADERS += socketcansource.h
+}
 
 FORMS    += mainwindow.ui \
     logdialog.ui \
-    capturedialog.ui
+    capturedialog.ui \
+    correlationdialog.ui
@@ -0,0 +1,353 @@
+#include "blfreader.h"
+#include <QDateTime>
+#include <QThread>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <zlib.h>
+#include "tracer.h"
+
+enum BlfObjectType { CanMessage = 1, LogContainer = 10, CanMessage2 = 86, CanFdMessage = 100, CanFdMessage64 = 101 };
+enum BlfCompression { NoCompression = 0, ZlibDeflate = 2 };
+
+const int objectHeaderBaseSize = 16;
+const int containerHeaderSize = 32;
+const quint32 maxObjectSize = 1 << 26;
+// writers use about 128 KiB per container, anything far larger is corrupt
+const quint32 maxContainerSize = 8 << 20;
+const quint32 timeTenMicros = 1;
+const quint32 canExtendedFlag = 0x80000000U;
+const quint8 canRemoteFlag = 0x80;
+const quint8 canFdEdl = 0x01;
+const quint32 canFd64Remote = 0x0010;
+const quint32 canFd64Edl = 0x1000;
+
+static inline quint16 u16(const uchar *p) { return qFromLittleEndian<quint16>(p); }
+static inline quint32 u32(const uchar *p) { return qFromLittleEndian<quint32>(p); }
+static inline quint64 u64(const uchar *p) { return qFromLittleEndian<quint64>(p); }
+
+static void inflateContainer(BlfReader::Container &c)
+{
+    if(c.method == NoCompression)
+    {
+        c.out = c.src;
+        c.outLen = c.srcLen;
+        return;
+    }
+
+    c.out = nullptr;
+    c.outLen = 0;
+    if(c.method != ZlibDeflate) return;
+
+    if((c.uncompressedSize == 0) || (c.uncompressedSize > maxContainerSize)) return;
+    if((c.srcLen == 0) || (c.srcLen > compressBound(c.uncompressedSize))) return;
+
+    c.buffer.resize(int(c.uncompressedSize));
+    uLongf len = c.uncompressedSize;
+    if(uncompress(reinterpret_cast<Bytef *>(c.buffer.data()), &len, c.src, c.srcLen) != Z_OK) return;
+    if(len != c.uncompressedSize) return;
+    c.out = reinterpret_cast<const uchar *>(c.buffer.constData());
+    c.outLen = len;
+}
+
+BlfReader::BlfReader(BusTable *buses)
+    :FrameReader(buses)
+{
+}
+
+BlfReader::~BlfReader()
+{
+    _future.waitForFinished();
+    if(_data) _file.unmap(const_cast<uchar *>(_data));
+}
+
+bool BlfReader::probe(const uchar *magic, int len)
+{
+    return (len >= 4) && (memcmp(magic, "LOGG", 4) == 0);
+}
+
+bool BlfReader::open(const QString &fname)
+{
+    _file.setFileName(fname);
+    if(!_file.open(QIODevice::ReadOnly))
+    {
+        _errorString = _file.errorString();
+        return false;
+    }
+    _size = _file.size();
+    if(_size < 72)
+    {
+        _errorString = QString("Truncated BLF file");
+        return false;
+    }
+    _data = _file.map(0, _size);
+    if(!_data)
+    {
+        _errorString = _file.errorString();
+        return false;
+    }
+    if(!probe(_data, 4))
+    {
+        _errorString = QString("Not a BLF file");
+        return false;
+    }
+
+    // measurement start is a SYSTEMTIME in local time
+    const uchar *st = _data + 40;
+    QDateTime start(QDate(u16(st), u16(st + 2), u16(st + 6)),
+                    QTime(u16(st + 8), u16(st + 10), u16(st + 12), u16(st + 14)));
+    _start = start.isValid() ? (quint64(start.toMSecsSinceEpoch()) * 1000) : 0;
+
+    if(!index()) return false;
+
+    _window = qMax(1, QThread::idealThreadCount() * 2);
+    _pos = 0;
+    _carry.clear();
+    _pending.clear();
+    _pendingPos = 0;
+    scheduleWindow(0);
+    return true;
+}
+
+bool BlfReader::index()
+{
+    TRACE_SCOPE("BlfReader::index");
+
+    _containers.clear();
+    qint64 off = u32(_data + 4);
+    while((off + objectHeaderBaseSize) <= _size)
+    {
+        const uchar *p = _data + off;
+        if(memcmp(p, "LOBJ", 4) != 0) break;
+        quint32 objectSize = u32(p + 8);
+        quint32 objectType = u32(p + 12);
+        if((objectSize < objectHeaderBaseSize) || ((off + objectSize) > _size)) break;
+
+        Container c;
+        c.offset = off;
+        c.size = objectSize;
+        c.out = nullptr;
+        c.outLen = 0;
+        if((objectType == LogContainer) && (objectSize >= containerHeaderSize))
+        {
+            c.method = u16(p + 16);
+            c.uncompressedSize = u32(p + 24);
+            c.src = p + containerHeaderSize;
+            c.srcLen = objectSize - containerHeaderSize;
+        }
+        else
+        {
+            // objects outside containers in old files
+            c.method = NoCompression;
+            c.uncompressedSize = objectSize;
+            c.src = p;
+            c.srcLen = objectSize;
+        }
+        _containers.append(c);
+        off += objectSize + (objectSize % 4);
+    }
+
+    if(_containers.isEmpty())
+    {
+        _errorString = QString("No log objects");
+        return false;
+    }
+    return true;
+}
+
+void BlfReader::scheduleWindow(int begin)
+{
+    _windowBegin = begin;
+    _windowEnd = qMin(begin + _window, _containers.size());
+    if(_windowBegin < _windowEnd)
+        _future = QtConcurrent::map(_containers.begin() + _windowBegin, _containers.begin() + _windowEnd, inflateContainer);
+}
+
+bool BlfReader::nextWindow()
+{
+    if(_windowBegin >= _windowEnd) return false;
+
+    {
+        TRACE_SCOPE("inflate");
+        _future.waitForFinished();
+    }
+    int begin = _windowBegin;
+    int end = _windowEnd;
+    // inflate the next window while this one is parsed
+    scheduleWindow(end);
+
+    TRACE_SCOPE("parse");
+    _pending.clear();
+    _pendingPos = 0;
+    Container *containers = _containers.data();
+    for(int i = begin; i < end; i++)
+    {
+        Container &c = containers[i];
+        if(!c.out)
+        {
+            // objects running into it are lost too
+            qWarning("BLF: container at offset %lld could not be inflated, skipped", c.offset);
+            _carry.clear();
+        }
+        else
+        {
+            // objects may continue in the next container
+            if(_carry.isEmpty())
+            {
+                int used = parseObjects(c.out, c.outLen);
+                _carry = QByteArray(reinterpret_cast<const char *>(c.out) + used, c.outLen - used);
+            }
+            else
+            {
+                _carry.append(reinterpret_cast<const char *>(c.out), c.outLen);
+                int used = parseObjects(reinterpret_cast<const uchar *>(_carry.constData()), _carry.size());
+                _carry.remove(0, used);
+            }
+        }
+        c.buffer = QByteArray();
+        c.out = nullptr;
+        _pos = c.offset + c.size;
+    }
+
+    std::stable_sort(_pending.begin(), _pending.end(), [](const CANFrame &a, const CANFrame &b)
+    {
+        return a.timestamp() < b.timestamp();
+    });
+    return true;
+}
+
+int BlfReader::read(CANFrame *frames, int max)
+{
+    int count = 0;
+    while(count < max)
+    {
+        if(_pendingPos == _pending.size())
+        {
+            if(!nextWindow()) break;
+            continue;
+        }
+        int n = qMin(max - count, _pending.size() - _pendingPos);
+        memcpy(frames + count, _pending.constData() + _pendingPos, n * sizeof(CANFrame));
+        count += n;
+        _pendingPos += n;
+    }
+    return count;
+}
+
+// returns the number of bytes consumed, an incomplete object is left over
+int BlfReader::parseObjects(const uchar *data, int len)
+{
+    int pos = 0;
+    for(;;)
+    {
+        // objects are padded, the next signature is within a few bytes
+        int found = -1;
+        for(int i = pos; (i < (pos + 8)) && ((i + 4) <= len); i++)
+        {
+            if(memcmp(data + i, "LOBJ", 4) == 0)
+            {
+                found = i;
+                break;
+            }
+        }
+        if(found < 0)
+        {
+            if((pos + 8 + 3) > len) return pos;
+            // lost sync, go on from the next signature, possibly in the next container
+            static const char signature[] = "LOBJ";
+            const uchar *next = std::search(data + pos, data + len, signature, signature + 4);
+            if(next == (data + len))
+            {
+                qWarning("BLF: no object signature in %d bytes, skipped", len - 3 - pos);
+                return len - 3;
+            }
+            qWarning("BLF: lost object sync, skipped %d bytes", int(next - data) - pos);
+            found = next - data;
+        }
+        pos = found;
+
+        if((len - pos) < objectHeaderBaseSize) return pos;
+        const uchar *p = data + pos;
+        quint16 headerSize = u16(p + 4);
+        quint32 objectSize = u32(p + 8);
+        quint32 objectType = u32(p + 12);
+        if((objectSize < objectHeaderBaseSize) || (headerSize > objectSize) || (objectSize > maxObjectSize))
+        {
+            pos += 4;
+            continue;
+        }
+        if(objectSize > quint32(len - pos)) return pos;
+
+        decodeObject(p, headerSize, objectSize, objectType);
+        pos += objectSize;
+    }
+}
+
+void BlfReader::decodeObject(const uchar *obj, quint16 headerSize, quint32 objectSize, quint32 objectType)
+{
+    if((objectType != CanMessage) && (objectType != CanMessage2)
+            && (objectType != CanFdMessage) && (objectType != CanFdMessage64)) return;
+    // both header versions keep flags at 16 and the timestamp at 24
+    if(headerSize < 32) return;
+
+    const uchar *body = obj + headerSize;
+    quint32 bodyLen = objectSize - headerSize;
+    quint64 ts = u64(obj + 24);
+    ts = (u32(obj + 16) == timeTenMicros) ? (ts * 10) : (ts / 1000);
+    ts += _start;
+
+    CANFrame f;
+    f.sec = ts / 1000000;
+    f.usec = ts % 1000000;
+    f.flags = 0;
+
+    quint32 channel;
+    quint32 canId;
+    const uchar *payload;
+    quint32 avail;
+    if((objectType == CanMessage) || (objectType == CanMessage2))
+    {
+        if(bodyLen < 16) return;
+        channel = u16(body);
+        if(body[2] & canRemoteFlag) f.flags |= CANFrame::Remote;
+        f.length = qMin<quint8>(body[3], 8);
+        canId = u32(body + 4);
+        payload = body + 8;
+        avail = 8;
+    }
+    else if(objectType == CanFdMessage)
+    {
+        if(bodyLen < 84) return;
+        channel = u16(body);
+        if(body[2] & canRemoteFlag) f.flags |= CANFrame::Remote;
+        canId = u32(body + 4);
+        if(body[13] & canFdEdl) f.flags |= CANFrame::FD;
+        f.length = qMin<quint8>(body[14], 64);
+        payload = body + 20;
+        avail = 64;
+    }
+    else
+    {
+        if(bodyLen < 40) return;
+        channel = body[0];
+        f.length = qMin<quint8>(body[2], 64);
+        canId = u32(body + 4);
+        quint32 flags = u32(body + 12);
+        if(flags & canFd64Remote) f.flags |= CANFrame::Remote;
+        if(flags & canFd64Edl) f.flags |= CANFrame::FD;
+        payload = body + 40;
+        avail = bodyLen - 40;
+    }
+
+    if(canId & canExtendedFlag) f.flags |= CANFrame::Extended;
+    f.id = canId & ~canExtendedFlag;
+    f.length = qMin<quint32>(f.length, avail);
+    memcpy(f.data, payload, f.length);
+
+    char name[16];
+    int nameLen = snprintf(name, sizeof(name), "CAN%u", channel);
+    f.bus = busHandle(name, nameLen);
+    _pending.append(f);
+}
@@ -0,0 +1,57 @@
+#ifndef BLFREADER_H
+#define BLFREADER_H
+
+#include <QFuture>
+#include "framereader.h"
+
+// Vector BLF reader. Log containers are indexed up front and inflated on the
+// global thread pool one window ahead of the parser.
+class BlfReader : public FrameReader
+{
+public:
+    explicit BlfReader(BusTable *buses);
+    ~BlfReader();
+
+    static bool probe(const uchar *magic, int len);
+
+    bool open(const QString &fname) override;
+    int read(CANFrame *frames, int max) override;
+    qint64 pos() const override { return _pos; }
+    qint64 size() const override { return _size; }
+
+    struct Container
+    {
+        qint64 offset;
+        quint32 size;
+        quint16 method;
+        quint32 uncompressedSize;
+        const uchar *src;
+        quint32 srcLen;
+        QByteArray buffer;
+        const uchar *out;
+        int outLen;
+    };
+
+protected:
+    bool index();
+    void scheduleWindow(int begin);
+    bool nextWindow();
+    int parseObjects(const uchar *data, int len);
+    void decodeObject(const uchar *obj, quint16 headerSize, quint32 objectSize, quint32 objectType);
+
+    QFile _file;
+    const uchar *_data = nullptr;
+    qint64 _size = 0;
+    qint64 _pos = 0;
+    quint64 _start = 0;
+    QVector<Container> _containers;
+    int _windowBegin = 0;
+    int _windowEnd = 0;
+    int _window = 1;
+    QFuture<void> _future;
+    QByteArray _carry;
+    QVector<CANFrame> _pending;
+    int _pendingPos = 0;
+};
+
+#endif // BLFREADER_H
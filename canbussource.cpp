@@ -0,0 +1,104 @@
+#include "canbussource.h"
+#include <QCanBus>
+#include <QCanBusFrame>
+#include "logmodel.h"
+#include "tracer.h"
+
+const int rxBatch = 256;
+
+CanBusSource::CanBusSource(LogModel *model, QObject *parent)
+    :QObject(parent)
+{
+    _model = model;
+    _frames.resize(rxBatch);
+}
+
+CanBusSource::~CanBusSource()
+{
+    close();
+}
+
+bool CanBusSource::open(const QString &plugin, const QString &interface)
+{
+    close();
+
+    QString errorString;
+    _device = QCanBus::instance()->createDevice(plugin, interface, &errorString);
+    if(!_device)
+    {
+        _errorString = QString("Error creating device '%1': '%2'").arg(plugin).arg(errorString);
+        return false;
+    }
+
+    connect(_device, &QCanBusDevice::errorOccurred, this, &CanBusSource::deviceError);
+    connect(_device, &QCanBusDevice::framesReceived, this, &CanBusSource::readFrames);
+
+    if(!_device->connectDevice())
+    {
+        _errorString = _device->errorString();
+        delete _device;
+        _device = nullptr;
+        return false;
+    }
+    _bus = _model->buses()->handle(interface);
+    return true;
+}
+
+void CanBusSource::close()
+{
+    if(!_device) return;
+
+    _device->disconnectDevice();
+    delete _device;
+    _device = nullptr;
+}
+
+void CanBusSource::convert(const QCanBusFrame &frame, quint16 bus, CANFrame &res)
+{
+    res.sec = frame.timeStamp().seconds();
+    res.usec = frame.timeStamp().microSeconds();
+    res.bus = bus;
+    res.id = frame.frameId();
+    res.flags = 0;
+    if(frame.hasExtendedFrameFormat()) res.flags |= CANFrame::Extended;
+    if(frame.hasFlexibleDataRateFormat()) res.flags |= CANFrame::FD;
+    if(frame.frameType() == QCanBusFrame::RemoteRequestFrame) res.flags |= CANFrame::Remote;
+    if(frame.frameType() == QCanBusFrame::ErrorFrame) res.flags |= CANFrame::Error;
+    const QByteArray payload = frame.payload();
+    res.length = qMin(payload.size(), 64);
+    memcpy(res.data, payload.constData(), res.length);
+}
+
+void CanBusSource::readFrames()
+{
+    if(!_device) return;
+
+    TRACE_SCOPE("framesReceived");
+    int count = 0;
+    while(_device->framesAvailable())
+    {
+        convert(_device->readFrame(), _bus, _frames[count]);
+        if(++count == _frames.size())
+        {
+            _model->procFrames(_frames.constData(), count);
+            count = 0;
+        }
+    }
+    if(count > 0) _model->procFrames(_frames.constData(), count);
+}
+
+void CanBusSource::deviceError(QCanBusDevice::CanBusError error)
+{
+    switch(error)
+    {
+    case QCanBusDevice::ReadError:
+    case QCanBusDevice::WriteError:
+    case QCanBusDevice::ConnectionError:
+    case QCanBusDevice::ConfigurationError:
+    case QCanBusDevice::UnknownError:
+        _errorString = _device->errorString();
+        emit errorOccurred(_errorString);
+    default:
+        break;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef CANBUSSOURCE_H
+#define CANBUSSOURCE_H
+
+#include <QCanBusDevice>
+#include <QObject>
+#include <QVector>
+#include "canframe.h"
+
+class LogModel;
+
+// Capture through a QCanBus plugin, frames go to LogModel::procFrames in batches.
+class CanBusSource : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CanBusSource(LogModel *model, QObject *parent = nullptr);
+    ~CanBusSource();
+
+    bool open(const QString &plugin, const QString &interface);
+    void close();
+    bool isOpen() const { return _device != nullptr; }
+
+    QString errorString() const { return _errorString; }
+    qint64 pending() const { return _device ? _device->framesAvailable() : 0; }
+
+    static void convert(const QCanBusFrame &frame, quint16 bus, CANFrame &res);
+
+signals:
+    void errorOccurred(const QString &error);
+
+private slots:
+    void readFrames();
+    void deviceError(QCanBusDevice::CanBusError error);
+
+private:
+    LogModel *_model = nullptr;
+    QCanBusDevice *_device = nullptr;
+    quint16 _bus = BusTable::NoBus;
+    QString _errorString;
+    QVector<CANFrame> _frames;
+};
+
+#endif // CANBUSSOURCE_H
@@ -0,0 +1,145 @@
+#include "canframe.h"
+#include <cstring>
+
+quint16 BusTable::handle(const QString &name)
+{
+    QMutexLocker lock(&_mutex);
+    int ix = _names.indexOf(name);
+    if(ix >= 0) return ix;
+    if(_names.size() >= NoBus) return NoBus;
+    _names.append(name);
+    return _names.size() - 1;
+}
+
+quint16 BusTable::handle(const char *name, int len)
+{
+    QMutexLocker lock(&_mutex);
+    QLatin1String lname(name, len);
+    for(int i = 0; i < _names.size(); i++)
+    {
+        if(_names[i] == lname) return i;
+    }
+    if(_names.size() >= NoBus) return NoBus;
+    _names.append(QString(lname));
+    return _names.size() - 1;
+}
+
+QString BusTable::name(quint16 handle) const
+{
+    QMutexLocker lock(&_mutex);
+    if(handle >= _names.size()) return QString();
+    return _names[handle];
+}
+
+int BusTable::size() const
+{
+    QMutexLocker lock(&_mutex);
+    return _names.size();
+}
+
+static inline int hexValue(char c)
+{
+    if((c >= '0') && (c <= '9')) return c - '0';
+    if((c >= 'a') && (c <= 'f')) return c - 'a' + 10;
+    if((c >= 'A') && (c <= 'F')) return c - 'A' + 10;
+    return -1;
+}
+
+static inline bool isSpace(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+static inline bool isWord(char c)
+{
+    return ((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'z'))
+            || ((c >= 'A') && (c <= 'Z')) || (c == '_');
+}
+
+// candump -l format: (sec.usec) bus id#data, id##Fdata for FD, id#R for RTR
+bool parseCandumpLine(const char *line, const char *end, CANFrame &frame, const char *&bus, int &busLen)
+{
+    const char *p = line;
+    if((p == end) || (*p != '(')) return false;
+    p++;
+
+    quint64 sec = 0;
+    const char *start = p;
+    while((p < end) && (*p >= '0') && (*p <= '9')) sec = sec * 10 + (*p++ - '0');
+    if((p == start) || (p == end) || (*p != '.')) return false;
+    p++;
+
+    quint32 usec = 0;
+    int digits = 0;
+    while((p < end) && (*p >= '0') && (*p <= '9'))
+    {
+        if(digits < 6) usec = usec * 10 + (*p - '0');
+        digits++;
+        p++;
+    }
+    if(digits == 0) return false;
+    for(; digits < 6; digits++) usec *= 10;
+    if((p == end) || (*p != ')')) return false;
+    p++;
+
+    start = p;
+    while((p < end) && ((*p == ' ') || (*p == '\t'))) p++;
+    if(p == start) return false;
+
+    bus = p;
+    while((p < end) && isWord(*p)) p++;
+    busLen = p - bus;
+    if(busLen == 0) return false;
+
+    start = p;
+    while((p < end) && ((*p == ' ') || (*p == '\t'))) p++;
+    if(p == start) return false;
+
+    quint32 id = 0;
+    int v;
+    start = p;
+    while((p < end) && ((v = hexValue(*p)) >= 0))
+    {
+        id = (id << 4) | v;
+        p++;
+    }
+    int idDigits = p - start;
+    if((idDigits == 0) || (idDigits > 8) || (p == end) || (*p != '#')) return false;
+    p++;
+
+    frame.sec = sec;
+    frame.usec = usec;
+    frame.id = id;
+    frame.flags = (idDigits > 3) ? CANFrame::Extended : 0;
+    frame.length = 0;
+
+    if((p < end) && (*p == '#'))
+    {
+        // FD flags nibble precedes the data
+        p++;
+        if((p == end) || (hexValue(*p) < 0)) return false;
+        p++;
+        frame.flags |= CANFrame::FD;
+    }
+    else if((p < end) && ((*p == 'R') || (*p == 'r')))
+    {
+        frame.flags |= CANFrame::Remote;
+        p++;
+        if((p < end) && ((v = hexValue(*p)) >= 0) && (v <= 8))
+        {
+            p++;
+            frame.length = v;
+            memset(frame.data, 0, v);
+        }
+        return true;
+    }
+
+    int hi, lo;
+    while(((p + 1) < end) && (frame.length < 64) && ((hi = hexValue(p[0])) >= 0) && ((lo = hexValue(p[1])) >= 0))
+    {
+        frame.data[frame.length++] = (hi << 4) | lo;
+        p += 2;
+    }
+    while((p < end) && isSpace(*p)) p++;
+    return (p == end);
+}
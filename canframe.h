@@ -0,0 +1,54 @@
+#ifndef CANFRAME_H
+#define CANFRAME_H
+
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+// Plain frame record passed between sources and the model, no heap storage.
+struct CANFrame
+{
+    enum Flags { Extended = 0x01, FD = 0x02, Remote = 0x04, Error = 0x08 };
+
+    quint64 sec;
+    quint32 usec;
+    quint16 bus;
+    quint8 flags;
+    quint8 length;
+    quint32 id;
+    quint8 data[64];
+
+    quint64 timestamp() const { return sec * 1000000 + usec; }
+    // first 8 payload bytes, first byte in the most significant position
+    quint64 payload() const
+    {
+        quint64 res = 0;
+        quint8 len = (length > 8) ? 8 : length;
+        for(int i = 0; i < len; i++)
+        {
+            res <<= 8;
+            res |= data[i];
+        }
+        return res;
+    }
+};
+
+// Interned bus names, frames carry the handle only.
+class BusTable
+{
+public:
+    enum { NoBus = 0xffff };
+
+    quint16 handle(const QString &name);
+    quint16 handle(const char *name, int len);
+    QString name(quint16 handle) const;
+    int size() const;
+
+protected:
+    mutable QMutex _mutex;
+    QVector<QString> _names;
+};
+
+bool parseCandumpLine(const char *line, const char *end, CANFrame &frame, const char *&bus, int &busLen);
+
+#endif // CANFRAME_H
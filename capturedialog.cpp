@@ -1,12 +1,18 @@
 #include "capturedialog.h"
 #include "ui_capturedialog.h"
 #include <QtSerialBus/QCanBus>
+#ifdef Q_OS_LINUX
+#include "socketcansource.h"
+#endif
 
 CaptureDialog::CaptureDialog(const QString &plugin, const QString &interface, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::CaptureDialog)
 {
     ui->setupUi(this);
+#ifdef Q_OS_LINUX
+    ui->selectPlugin->addItem(SocketCanSource::pluginName());
+#endif
     ui->selectPlugin->addItems(QCanBus::instance()->plugins());
     ui->selectPlugin->setCurrentText(plugin);
     ui->selectInterface->setCurrentText(interface);
@@ -30,6 +36,13 @@ QString CaptureDialog::interface()
 void CaptureDialog::on_selectPlugin_currentTextChanged(const QString &arg1)
 {
     ui->selectInterface->clear();
+#ifdef Q_OS_LINUX
+    if(arg1 == SocketCanSource::pluginName())
+    {
+        ui->selectInterface->addItems(SocketCanSource::interfaces());
+        return;
+    }
+#endif
     QList<QCanBusDeviceInfo> ifs = QCanBus::instance()->availableDevices(arg1);
     for(const QCanBusDeviceInfo &info : qAsConst(ifs))
         ui->selectInterface->addItem(info.name());
@@ -0,0 +1,239 @@
+#include "captureserver.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include "logmodel.h"
+#include "tracer.h"
+
+const int defaultIntervalMs = 100;
+// a client this far behind gets a snapshot once it has caught up
+const qint64 maxBacklog = 16 * 1024 * 1024;
+// change log entries per row in a snapshot, a resync does not resend hours of history
+const int maxSnapshotChanges = 256;
+
+CaptureServer::CaptureServer(LogModel *model, QObject *parent)
+    :QObject(parent)
+{
+    _model = model;
+    _timer.setInterval(defaultIntervalMs);
+    connect(&_timer, &QTimer::timeout, this, &CaptureServer::tick);
+}
+
+bool CaptureServer::listen(const QString &address)
+{
+    QString host;
+    quint16 port;
+    if(RemoteProtocol::splitTcp(address, host, port))
+    {
+        _tcp = new QTcpServer(this);
+        // all interfaces only when asked for by address, 0.0.0.0 or ::
+        QHostAddress bind = (host.isEmpty() || (host == "*")) ? QHostAddress(QHostAddress::LocalHost) : QHostAddress(host);
+        if(!_tcp->listen(bind, port))
+        {
+            _errorString = _tcp->errorString();
+            return false;
+        }
+        connect(_tcp, &QTcpServer::newConnection, this, &CaptureServer::tcpConnection);
+    }
+    else
+    {
+        _local = new QLocalServer(this);
+        // a crashed server leaves its socket file behind
+        QLocalServer::removeServer(address);
+        if(!_local->listen(address))
+        {
+            _errorString = _local->errorString();
+            return false;
+        }
+        connect(_local, &QLocalServer::newConnection, this, &CaptureServer::localConnection);
+    }
+    _timer.start();
+    return true;
+}
+
+quint16 CaptureServer::serverPort() const
+{
+    return _tcp ? _tcp->serverPort() : 0;
+}
+
+void CaptureServer::localConnection()
+{
+    while(QLocalSocket *socket = _local->nextPendingConnection())
+    {
+        connect(socket, &QLocalSocket::disconnected, this, &CaptureServer::clientDisconnected);
+        addClient(socket, true);
+    }
+}
+
+void CaptureServer::tcpConnection()
+{
+    while(QTcpSocket *socket = _tcp->nextPendingConnection())
+    {
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        connect(socket, &QTcpSocket::disconnected, this, &CaptureServer::clientDisconnected);
+        // IPv4 peers of a dual stack server show up as ::ffff:a.b.c.d
+        QHostAddress peer = socket->peerAddress();
+        bool ok;
+        quint32 ipv4 = peer.toIPv4Address(&ok);
+        if(ok) peer = QHostAddress(ipv4);
+        addClient(socket, _remoteControl || peer.isLoopback());
+    }
+}
+
+void CaptureServer::addClient(QIODevice *socket, bool control)
+{
+    connect(socket, &QIODevice::readyRead, this, &CaptureServer::clientReadyRead);
+    Client client;
+    client.control = control;
+    _clients.insert(socket, client);
+}
+
+void CaptureServer::clientDisconnected()
+{
+    QIODevice *socket = qobject_cast<QIODevice *>(sender());
+    _clients.remove(socket);
+    socket->deleteLater();
+}
+
+void CaptureServer::clientReadyRead()
+{
+    QIODevice *socket = qobject_cast<QIODevice *>(sender());
+    QHash<QIODevice *, Client>::iterator it = _clients.find(socket);
+    if(it == _clients.end()) return;
+
+    it->rx.append(socket->readAll());
+    QByteArray payload;
+    while(RemoteProtocol::takeMessage(it->rx, payload))
+    {
+        if(it->control)
+        {
+            execute(payload);
+        }
+        else if(!it->warned)
+        {
+            it->warned = true;
+            QTcpSocket *tcp = qobject_cast<QTcpSocket *>(socket);
+            qWarning("Ignoring commands from %s, the server was started without --remote-control",
+                     qPrintable(tcp ? tcp->peerAddress().toString() : QString()));
+        }
+    }
+}
+
+void CaptureServer::execute(const QByteArray &payload)
+{
+    RemoteProtocol::CommandType command;
+    bool value;
+    if(!RemoteProtocol::decodeCommand(payload, command, value)) return;
+
+    switch(command)
+    {
+    case RemoteProtocol::SetLogChange:
+        _model->setLogChange(value);
+        break;
+    case RemoteProtocol::SetGenMask:
+        _model->setGenMask(value);
+        break;
+    case RemoteProtocol::SetFiltering:
+        _model->setFiltering(value);
+        break;
+    case RemoteProtocol::ClearStatus:
+        _model->clearStatus();
+        break;
+    case RemoteProtocol::ClearMasks:
+        _model->clearMasks();
+        break;
+    case RemoteProtocol::ClearChanges:
+        _model->clearChanges();
+        break;
+    default:
+        break;
+    }
+}
+
+void CaptureServer::send(QIODevice *socket, Client &client, const QByteArray &message)
+{
+    if(socket->bytesToWrite() > maxBacklog)
+    {
+        client.resync = true;
+        return;
+    }
+    socket->write(message);
+}
+
+void CaptureServer::tick()
+{
+    if(_clients.isEmpty()) return;
+
+    TRACE_SCOPE("CaptureServer::tick");
+    PipelineStats *stats = _model->stats();
+    stats->set(PipelineStats::MemoryBytes, _model->memoryUsage());
+    stats->sample();
+
+    if(_model->generation() != _generation)
+    {
+        // rows were added, removed or renamed by hand, everyone starts over
+        _generation = _model->generation();
+        _sent.clear();
+        for(Client &client : _clients) client.resync = true;
+    }
+
+    RemoteUpdate delta;
+    delta.generation = _generation;
+    delta.firstTimestamp = _model->firstTimestamp();
+    delta.lastTimestamp = _model->lastTimestamp();
+    delta.stats = stats->summary();
+    RemoteUpdate snapshot = delta;
+    snapshot.snapshot = true;
+
+    bool needSnapshot = false;
+    for(const Client &client : _clients) needSnapshot |= client.resync;
+
+    int rows = _model->rowCount();
+    int published = _sent.size();
+    if(published > rows) published = 0;
+    _sent.resize(rows);
+    for(int i = 0; i < rows; i++)
+    {
+        const CANMessage &msg = _model->message(i);
+        Shadow &sent = _sent[i];
+        quint32 changes = msg.changeLog.size();
+        if(needSnapshot) snapshot.rows.append(_model->exportRow(i, qMax(0, int(changes) - maxSnapshotChanges)));
+        // the log is resent whole once it was cleared, even if it regrew since
+        bool fresh = (i >= published) || (sent.bus != msg.bus) || (sent.id != msg.id) || (sent.logEpoch != msg.logEpoch);
+        if(!fresh && (sent.status == msg.status) && (sent.length == msg.length)
+                && (sent.data == msg.data) && (sent.bitmask == msg.bitmask) && (sent.chbits == msg.chbits)
+                && (sent.known == msg.known) && (sent.changes == changes))
+        {
+            continue;
+        }
+        delta.rows.append(_model->exportRow(i, fresh ? 0 : sent.changes));
+        sent.bus = msg.bus;
+        sent.id = msg.id;
+        sent.logEpoch = msg.logEpoch;
+        sent.status = msg.status;
+        sent.length = msg.length;
+        sent.data = msg.data;
+        sent.bitmask = msg.bitmask;
+        sent.chbits = msg.chbits;
+        sent.known = msg.known;
+        sent.changes = changes;
+    }
+
+    QByteArray deltaMessage = RemoteProtocol::encodeUpdate(delta);
+    QByteArray snapshotMessage;
+    if(needSnapshot) snapshotMessage = RemoteProtocol::encodeUpdate(snapshot);
+    for(QHash<QIODevice *, Client>::iterator it = _clients.begin(); it != _clients.end(); ++it)
+    {
+        if(it->resync)
+        {
+            if(it.key()->bytesToWrite() > 0) continue;
+            it->resync = false;
+            send(it.key(), *it, snapshotMessage);
+        }
+        else
+        {
+            send(it.key(), *it, deltaMessage);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef CAPTURESERVER_H
+#define CAPTURESERVER_H
+
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include "remoteprotocol.h"
+
+class LogModel;
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+
+// Publishes the rows of a LogModel to attached GUIs at a fixed rate.
+// New clients get a snapshot, then only the rows changed since the last tick.
+class CaptureServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CaptureServer(LogModel *model, QObject *parent = nullptr);
+
+    // a local socket name, or host:port for TCP, bound to localhost
+    // unless a host is given
+    bool listen(const QString &address);
+    // the bound TCP port, 0 for a local socket
+    quint16 serverPort() const;
+    void setInterval(int ms) { _timer.setInterval(ms); }
+    // TCP clients on other hosts may only watch unless this is set
+    void setRemoteControl(bool allow) { _remoteControl = allow; }
+    bool remoteControl() const { return _remoteControl; }
+    QString errorString() const { return _errorString; }
+
+private slots:
+    void localConnection();
+    void tcpConnection();
+    void clientReadyRead();
+    void clientDisconnected();
+    void tick();
+
+private:
+    class Shadow
+    {
+    public:
+        quint16 bus = 0;
+        quint32 id = 0;
+        quint32 logEpoch = 0;
+        quint8 status = 0;
+        quint8 length = 0;
+        quint64 data = 0;
+        quint64 bitmask = 0;
+        quint64 chbits = 0;
+        quint64 known = 0;
+        quint32 changes = 0;
+    };
+
+    struct Client
+    {
+        QByteArray rx;
+        bool resync = true;
+        bool control = true;
+        bool warned = false;
+    };
+
+    void addClient(QIODevice *socket, bool control);
+    void send(QIODevice *socket, Client &client, const QByteArray &message);
+    void execute(const QByteArray &payload);
+
+    LogModel *_model = nullptr;
+    QLocalServer *_local = nullptr;
+    QTcpServer *_tcp = nullptr;
+    QTimer _timer;
+    QHash<QIODevice *, Client> _clients;
+    QVector<Shadow> _sent;
+    quint32 _generation = 0;
+    QString _errorString;
+    bool _remoteControl = false;
+};
+
+#endif // CAPTURESERVER_H
@@ -0,0 +1,80 @@
+#include "changeindex.h"
+#include <algorithm>
+
+void ChangeIndex::append(quint64 ts, quint64 delta)
+{
+    if(_times.isEmpty() || (ts >= _times.last()))
+    {
+        if(!_ordered)
+        {
+            _arrivalTimes.append(ts);
+            _arrivalDeltas.append(delta);
+        }
+        _times.append(ts);
+        _levels[0].append(delta);
+        update(_levels[0].size() - 1);
+        return;
+    }
+
+    if(_ordered)
+    {
+        // first step back in time, arrival order needs its own copy from now on
+        _arrivalTimes = _times;
+        _arrivalDeltas = _levels[0];
+        _ordered = false;
+    }
+    _arrivalTimes.append(ts);
+    _arrivalDeltas.append(delta);
+
+    // behind entries of the same time, they keep their arrival order
+    int ix = std::upper_bound(_times.constBegin(), _times.constEnd(), ts) - _times.constBegin();
+    _times.insert(ix, ts);
+    _levels[0].insert(ix, delta);
+    update(ix);
+}
+
+// refresh the parents of the entries from ix on, on every level
+void ChangeIndex::update(int ix)
+{
+    for(int k = 1; _levels[k - 1].size() > 1; k++)
+    {
+        if(_levels.size() == k) _levels.append(QVector<quint64>());
+        const QVector<quint64> &below = _levels[k - 1];
+        QVector<quint64> &level = _levels[k];
+        ix /= 2;
+        level.resize((below.size() + 1) / 2);
+        for(int i = ix; i < level.size(); i++)
+        {
+            quint64 value = below[i * 2];
+            if((i * 2 + 1) < below.size()) value |= below[i * 2 + 1];
+            level[i] = value;
+        }
+    }
+}
+
+void ChangeIndex::clear()
+{
+    _times.clear();
+    _levels.resize(1);
+    _levels[0].clear();
+    _arrivalTimes.clear();
+    _arrivalDeltas.clear();
+    _ordered = true;
+}
+
+quint64 ChangeIndex::bits(quint64 from, quint64 to) const
+{
+    int l = std::lower_bound(_times.constBegin(), _times.constEnd(), from) - _times.constBegin();
+    int r = std::lower_bound(_times.constBegin(), _times.constEnd(), to) - _times.constBegin();
+
+    quint64 res = 0;
+    for(int k = 0; (l < r) && (k < _levels.size()); k++)
+    {
+        const QVector<quint64> &level = _levels[k];
+        if(l & 1) res |= level[l++];
+        if(r & 1) res |= level[--r];
+        l /= 2;
+        r /= 2;
+    }
+    return res;
+}
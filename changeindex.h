@@ -0,0 +1,42 @@
+#ifndef CHANGEINDEX_H
+#define CHANGEINDEX_H
+
+#include <QVector>
+
+// XOR deltas of one ID in time order with a pyramid of OR-ed pairs above
+// them, so the changing bits of any time range take O(log n). Merged logs,
+// clock jumps and remote updates can append out of time order, such an entry
+// is inserted at its time and the pyramid is rebuilt from there on. Arrival
+// order is only kept apart once that happened.
+class ChangeIndex
+{
+public:
+    ChangeIndex() : _levels(1) {}
+
+    void append(quint64 ts, quint64 delta);
+    void clear();
+    int size() const { return _times.size(); }
+    // timestamps never went backwards, arrival and time order are the same
+    bool ordered() const { return _ordered; }
+
+    // bits that toggled in [from, to), timestamps in microseconds
+    quint64 bits(quint64 from, quint64 to) const;
+
+    // parallel arrays in arrival order
+    const QVector<quint64> &times() const { return _ordered ? _times : _arrivalTimes; }
+    const QVector<quint64> &deltas() const { return _ordered ? _levels[0] : _arrivalDeltas; }
+    // parallel arrays in time order, equal times in arrival order
+    const QVector<quint64> &sortedTimes() const { return _times; }
+    const QVector<quint64> &sortedDeltas() const { return _levels[0]; }
+
+protected:
+    void update(int ix);
+
+    QVector<quint64> _times;
+    QVector<QVector<quint64>> _levels;
+    QVector<quint64> _arrivalTimes;
+    QVector<quint64> _arrivalDeltas;
+    bool _ordered = true;
+};
+
+#endif // CHANGEINDEX_H
@@ -0,0 +1,69 @@
+#include "correlationdialog.h"
+#include "ui_correlationdialog.h"
+#include <QApplication>
+#include <QSettings>
+#include "logmodel.h"
+
+const QString BEFORE_KEY("correlation_before_ms");
+const QString AFTER_KEY("correlation_window_ms");
+
+CorrelationDialog::CorrelationDialog(QWidget *parent, const LogModel *model) :
+    QDialog(parent),
+    ui(new Ui::CorrelationDialog)
+{
+    ui->setupUi(this);
+    this->model = model;
+
+    ui->tableWidget->setColumnCount(END);
+    ui->tableWidget->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    ui->tableWidget->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    QStringList headers;
+    headers.append(QString("CAN"));
+    headers.append(QString("ID"));
+    headers.append(QString("Byte.bit"));
+    headers.append(QString("Hits"));
+    headers.append(QString("Baseline"));
+    headers.append(QString("Score"));
+    ui->tableWidget->setHorizontalHeaderLabels(headers);
+
+    // a marker is often pressed a moment after the action it marks
+    QSettings settings;
+    ui->spinBefore->setValue(settings.value(BEFORE_KEY, 200).toInt());
+    ui->spinAfter->setValue(settings.value(AFTER_KEY, 500).toInt());
+    on_btnCorrelate_clicked();
+}
+
+CorrelationDialog::~CorrelationDialog()
+{
+    delete ui;
+}
+
+void CorrelationDialog::on_btnCorrelate_clicked()
+{
+    QSettings settings;
+    settings.setValue(BEFORE_KEY, ui->spinBefore->value());
+    settings.setValue(AFTER_KEY, ui->spinAfter->value());
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    fill(model->correlate(quint64(ui->spinBefore->value()) * 1000, quint64(ui->spinAfter->value()) * 1000));
+    QApplication::restoreOverrideCursor();
+}
+
+void CorrelationDialog::fill(const QVector<CorrelationCandidate> &candidates)
+{
+    ui->tableWidget->clearContents();
+    ui->tableWidget->setRowCount(candidates.size());
+    int i = 0;
+    foreach(const CorrelationCandidate &item, candidates)
+    {
+        // bit 0 is the last bit of the last byte, as in the bitmask
+        int byte = (item.length - 1) - (item.bit / 8);
+        ui->tableWidget->setItem(i, CAN, new QTableWidgetItem(item.can));
+        ui->tableWidget->setItem(i, ID, new QTableWidgetItem(QString("%1").arg(item.id, 3, 16, QChar('0'))));
+        ui->tableWidget->setItem(i, BIT, new QTableWidgetItem(QString("%1.%2").arg(byte).arg(item.bit % 8)));
+        ui->tableWidget->setItem(i, HITS, new QTableWidgetItem(QString("%1/%2").arg(item.hits).arg(item.markers)));
+        ui->tableWidget->setItem(i, BASELINE, new QTableWidgetItem(QString("%1%").arg(item.baseline * 100.0, 0, 'f', 1)));
+        ui->tableWidget->setItem(i, SCORE, new QTableWidgetItem(QString::number(item.score, 'f', 3)));
+        i++;
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef CORRELATIONDIALOG_H
+#define CORRELATIONDIALOG_H
+
+#include <QDialog>
+#include "correlator.h"
+
+class LogModel;
+
+namespace Ui {
+class CorrelationDialog;
+}
+
+class CorrelationDialog : public QDialog
+{
+    Q_OBJECT
+
+    enum Columns { CAN = 0, ID = 1, BIT = 2, HITS = 3, BASELINE = 4, SCORE = 5, END = 6 };
+
+public:
+    explicit CorrelationDialog(QWidget *parent, const LogModel *model);
+    ~CorrelationDialog();
+
+private slots:
+    void on_btnCorrelate_clicked();
+
+private:
+    void fill(const QVector<CorrelationCandidate> &candidates);
+
+    Ui::CorrelationDialog *ui;
+    const LogModel *model;
+};
+
+#endif // CORRELATIONDIALOG_H
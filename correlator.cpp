@@ -0,0 +1,131 @@
+#include "correlator.h"
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include "logmodel.h"
+
+// Bit-sliced counters, one add counts all 64 bit lanes at once.
+class LaneCounter
+{
+public:
+    void add(quint64 mask)
+    {
+        for(int j = 0; mask && (j < 32); j++)
+        {
+            quint64 carry = _planes[j] & mask;
+            _planes[j] ^= mask;
+            mask = carry;
+        }
+    }
+
+    quint32 lane(int bit) const
+    {
+        quint32 res = 0;
+        for(int j = 0; j < 32; j++) res |= quint32((_planes[j] >> bit) & 1) << j;
+        return res;
+    }
+
+private:
+    quint64 _planes[32] = {};
+};
+
+Correlator::Correlator(const QVector<quint64> &markers, quint64 before, quint64 after, quint64 begin, quint64 end)
+{
+    _markers = markers;
+    std::sort(_markers.begin(), _markers.end());
+    _before = before;
+    _after = after;
+    _begin = begin;
+    _end = end;
+}
+
+QVector<CorrelationCandidate> Correlator::run(const QVector<const CANMessage *> &msgs, int limit) const
+{
+    struct Job
+    {
+        const CANMessage *msg;
+        QVector<CorrelationCandidate> out;
+    };
+    QVector<Job> jobs;
+    jobs.reserve(msgs.size());
+    for(const CANMessage *msg : msgs)
+    {
+        if(msg->changes.size() > 0) jobs.append({ msg, QVector<CorrelationCandidate>() });
+    }
+
+    QtConcurrent::blockingMap(jobs, [this](Job &job) { score(*job.msg, job.out); });
+
+    QVector<CorrelationCandidate> res;
+    for(const Job &job : jobs) res += job.out;
+    std::sort(res.begin(), res.end(), [](const CorrelationCandidate &a, const CorrelationCandidate &b)
+    {
+        if(a.score != b.score) return a.score > b.score;
+        return a.hits > b.hits;
+    });
+    if(res.size() > limit) res.resize(limit);
+    return res;
+}
+
+void Correlator::score(const CANMessage &msg, QVector<CorrelationCandidate> &out) const
+{
+    if(_markers.isEmpty()) return;
+
+    // flat arrays of the change index in time order, the scans below stay sequential
+    const QVector<quint64> &times = msg.changes.sortedTimes();
+    const QVector<quint64> &deltas = msg.changes.sortedDeltas();
+
+    LaneCounter hits;
+    LaneCounter outside;
+    quint64 toggledAny = 0;
+    quint64 covered = 0;
+    quint64 inside = 0;
+    int n = times.size();
+    int i = 0;
+    for(quint64 m : _markers)
+    {
+        // the window starts keep the order of the markers
+        quint64 from = (m > _before) ? (m - _before) : 0;
+        quint64 to = m + _after;
+        while((i < n) && (times[i] < from))
+        {
+            if(times[i] >= covered) outside.add(deltas[i]);
+            i++;
+        }
+        quint64 toggled = 0;
+        for(int j = i; (j < n) && (times[j] < to); j++) toggled |= deltas[j];
+        hits.add(toggled);
+        toggledAny |= toggled;
+
+        inside += to - qMax(from, qMin(covered, to));
+        covered = qMax(covered, to);
+    }
+    for(; i < n; i++)
+    {
+        if(times[i] >= covered) outside.add(deltas[i]);
+    }
+    if(!toggledAny) return;
+
+    quint64 total = (_end > _begin) ? (_end - _begin) : 0;
+    double outsideTime = (total > inside) ? double(total - inside) : 0.0;
+    quint64 window = _before + _after;
+    outsideTime = qMax(outsideTime, double(window));
+    int markers = _markers.size();
+
+    for(int bit = 0; bit < 64; bit++)
+    {
+        if(!((toggledAny >> bit) & 1)) continue;
+
+        CorrelationCandidate c;
+        c.can = msg.can;
+        c.id = msg.id;
+        c.length = msg.length;
+        c.bit = bit;
+        c.hits = hits.lane(bit);
+        c.markers = markers;
+        // chance of a noise toggle inside one window
+        double rate = outside.lane(bit) / outsideTime;
+        c.baseline = 1.0 - std::exp(-rate * window);
+        c.score = (double(c.hits) / markers) - c.baseline;
+        if(c.score > 0.0) out.append(c);
+    }
+}
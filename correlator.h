@@ -0,0 +1,42 @@
+#ifndef CORRELATOR_H
+#define CORRELATOR_H
+
+#include <QString>
+#include <QVector>
+
+class CANMessage;
+
+class CorrelationCandidate
+{
+public:
+    QString can;
+    quint32 id = 0;
+    quint8 length = 0;
+    int bit = 0;
+    int hits = 0;
+    int markers = 0;
+    double baseline = 0.0;
+    double score = 0.0;
+};
+
+// Scores every (ID, bit) by how often it toggles around the markers, in
+// [marker - before, marker + after), compared with how often it toggles
+// anywhere else. A marker pressed late still sees the toggle before it.
+class Correlator
+{
+public:
+    Correlator(const QVector<quint64> &markers, quint64 before, quint64 after, quint64 begin, quint64 end);
+
+    QVector<CorrelationCandidate> run(const QVector<const CANMessage *> &msgs, int limit = 200) const;
+
+protected:
+    void score(const CANMessage &msg, QVector<CorrelationCandidate> &out) const;
+
+    QVector<quint64> _markers;
+    quint64 _before = 0;
+    quint64 _after = 0;
+    quint64 _begin = 0;
+    quint64 _end = 0;
+};
+
+#endif // CORRELATOR_H
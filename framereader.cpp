@@ -0,0 +1,141 @@
+#include "framereader.h"
+#include <cstring>
+#include "blfreader.h"
+#include "pcapreader.h"
+#include "tracer.h"
+
+const int readChunk = 1 << 20;
+
+FrameReader *FrameReader::create(const QString &fname, BusTable *buses)
+{
+    QFile file(fname);
+    uchar magic[4];
+    int len = 0;
+    if(file.open(QIODevice::ReadOnly)) len = file.read(reinterpret_cast<char *>(magic), sizeof(magic));
+
+    if(PcapReader::probe(magic, len)) return new PcapReader(buses);
+    if(BlfReader::probe(magic, len)) return new BlfReader(buses);
+    return new CandumpReader(buses);
+}
+
+quint16 FrameReader::busHandle(const char *name, int len)
+{
+    // a log has a handful of buses, skip the locked table for known names
+    for(int i = 0; i < _busCache.size(); i++)
+    {
+        const BusCacheEntry &entry = _busCache[i];
+        if((entry.len == len) && (memcmp(entry.name, name, len) == 0)) return entry.handle;
+    }
+
+    quint16 handle = _buses->handle(name, len);
+    if(len <= (int)sizeof(BusCacheEntry::name))
+    {
+        BusCacheEntry entry;
+        memcpy(entry.name, name, len);
+        entry.len = len;
+        entry.handle = handle;
+        _busCache.append(entry);
+    }
+    return handle;
+}
+
+CandumpReader::CandumpReader(BusTable *buses)
+    :FrameReader(buses)
+{
+}
+
+bool CandumpReader::open(const QString &fname)
+{
+    _file.setFileName(fname);
+    if(!_file.open(QIODevice::ReadOnly))
+    {
+        _errorString = _file.errorString();
+        return false;
+    }
+    _buffer.resize(readChunk);
+    _start = 0;
+    _fill = 0;
+    _pos = 0;
+    _eof = false;
+    return true;
+}
+
+// continues after the last complete line, false when the file shrank
+bool CandumpReader::resume()
+{
+    // sync tools replace the file, reopen by name
+    _file.close();
+    if(!_file.open(QIODevice::ReadOnly))
+    {
+        _errorString = _file.errorString();
+        return false;
+    }
+    _start = 0;
+    _fill = 0;
+    _eof = false;
+    if(_file.size() < _pos)
+    {
+        _pos = 0;
+        return false;
+    }
+    return _file.seek(_pos);
+}
+
+// pos must be at the start of a line, as pos() always is
+bool CandumpReader::seek(qint64 pos)
+{
+    _start = 0;
+    _fill = 0;
+    _eof = false;
+    _pos = pos;
+    return _file.seek(pos);
+}
+
+void CandumpReader::refill()
+{
+    TRACE_SCOPE("read");
+
+    int tail = _fill - _start;
+    if((tail > 0) && (_start > 0)) memmove(_buffer.data(), _buffer.constData() + _start, tail);
+    _start = 0;
+    _fill = tail;
+    // a single line longer than the buffer
+    if(_fill == _buffer.size()) _buffer.resize(_buffer.size() * 2);
+
+    qint64 n = _file.read(_buffer.data() + _fill, _buffer.size() - _fill);
+    if(n <= 0) _eof = true;
+    else _fill += n;
+}
+
+int CandumpReader::read(CANFrame *frames, int max)
+{
+    TRACE_SCOPE("parse");
+
+    int count = 0;
+    const char *bus = nullptr;
+    int busLen = 0;
+    while(count < max)
+    {
+        const char *line = _buffer.constData() + _start;
+        const char *nl = static_cast<const char *>(memchr(line, '\n', _fill - _start));
+        const char *end = nl ? (nl + 1) : (_buffer.constData() + _fill);
+        if(!nl)
+        {
+            if(!_eof)
+            {
+                refill();
+                continue;
+            }
+            // last line without newline
+            if((end == line) || _follow) break;
+        }
+        _start += end - line;
+        _pos += end - line;
+        if(parseCandumpLine(line, end, frames[count], bus, busLen))
+        {
+            frames[count].bus = busHandle(bus, busLen);
+            count++;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,74 @@
+#ifndef FRAMEREADER_H
+#define FRAMEREADER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include "canframe.h"
+
+// Streaming source of frames read from a log file in batches.
+class FrameReader
+{
+public:
+    explicit FrameReader(BusTable *buses) : _buses(buses) {}
+    virtual ~FrameReader() {}
+
+    // picks the reader matching the file contents, candump text by default
+    static FrameReader *create(const QString &fname, BusTable *buses);
+
+    virtual bool open(const QString &fname) = 0;
+    // fills at most max frames, returns 0 at the end of the log
+    virtual int read(CANFrame *frames, int max) = 0;
+    virtual qint64 pos() const = 0;
+    virtual qint64 size() const = 0;
+    // readers whose pos() is a byte offset they can restart from
+    virtual bool seekable() const { return false; }
+    virtual bool seek(qint64 pos) { Q_UNUSED(pos); return false; }
+
+    QString errorString() const { return _errorString; }
+
+protected:
+    quint16 busHandle(const char *name, int len);
+
+    BusTable *_buses = nullptr;
+    QString _errorString;
+
+private:
+    struct BusCacheEntry
+    {
+        char name[16];
+        int len;
+        quint16 handle;
+    };
+    QVector<BusCacheEntry> _busCache;
+};
+
+class CandumpReader : public FrameReader
+{
+public:
+    explicit CandumpReader(BusTable *buses);
+
+    bool open(const QString &fname) override;
+    int read(CANFrame *frames, int max) override;
+    qint64 pos() const override { return _pos; }
+    qint64 size() const override { return _file.size(); }
+    bool seekable() const override { return true; }
+    bool seek(qint64 pos) override;
+
+    // follow mode keeps an unterminated last line for the next round
+    void setFollow(bool val) { _follow = val; }
+    bool resume();
+
+protected:
+    void refill();
+
+    QFile _file;
+    QByteArray _buffer;
+    int _start = 0;
+    int _fill = 0;
+    qint64 _pos = 0;
+    bool _eof = false;
+    bool _follow = false;
+};
+
+#endif // FRAMEREADER_H
@@ -0,0 +1,327 @@
+#include "journal.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <zlib.h>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+#include "logmodel.h"
+
+// group commit window, edits within it share one sync
+const int commitDelayMs = 250;
+const int compactMinRecords = 1024;
+const int recordHeaderSize = 8;
+
+Journal::Journal(QObject *parent)
+    :QObject(parent)
+{
+    _commitTimer.setSingleShot(true);
+    _commitTimer.setInterval(commitDelayMs);
+    connect(&_commitTimer, &QTimer::timeout, this, &Journal::commit);
+}
+
+Journal::~Journal()
+{
+    close();
+}
+
+bool Journal::open(const QString &fname)
+{
+    close();
+    _file.setFileName(fname);
+    if(!_file.open(QIODevice::ReadWrite))
+    {
+        _errorString = _file.errorString();
+        return false;
+    }
+    if(!replay()) return false;
+    if((_records > compactMinRecords) && (_records > (2 * liveRecords()))) compact();
+    return true;
+}
+
+void Journal::close()
+{
+    if(!_file.isOpen()) return;
+    _commitTimer.stop();
+    commit();
+    _file.close();
+}
+
+bool Journal::replay()
+{
+    QByteArray data = _file.readAll();
+    qint64 good = 0;
+    _records = 0;
+    _state.clear();
+    while((data.size() - good) >= recordHeaderSize)
+    {
+        const uchar *p = reinterpret_cast<const uchar *>(data.constData()) + good;
+        quint32 len = qFromLittleEndian<quint32>(p);
+        quint32 crc = qFromLittleEndian<quint32>(p + 4);
+        if((data.size() - good - recordHeaderSize) < len) break;
+        if(crc32(0, p + recordHeaderSize, len) != crc) break;
+
+        apply(QByteArray::fromRawData(data.constData() + good + recordHeaderSize, len));
+        good += recordHeaderSize + len;
+        _records++;
+    }
+
+    // drop a record torn by a crash
+    if(good < data.size()) _file.resize(good);
+    if(!_file.seek(good))
+    {
+        _errorString = _file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void Journal::apply(const QByteArray &payload)
+{
+    QDataStream in(payload);
+    quint8 type;
+    in >> type;
+    if(type == ClearMasks)
+    {
+        for(State &state : _state) state.hasMask = false;
+        return;
+    }
+
+    QString can;
+    quint32 id;
+    in >> can >> id;
+    State &state = _state[Key(can, id)];
+    switch(type)
+    {
+    case IdNote:
+        in >> state.note;
+        state.hasNote = true;
+        break;
+    case ChangeNote:
+    {
+        quint64 ts;
+        QString note;
+        in >> ts >> note;
+        if(note.isEmpty()) state.changeNotes.remove(ts);
+        else state.changeNotes.insert(ts, note);
+        break;
+    }
+    case Mask:
+        in >> state.length >> state.mask;
+        state.hasMask = true;
+        break;
+    default:
+        break;
+    }
+}
+
+QByteArray Journal::frame(const QByteArray &payload)
+{
+    QByteArray res(recordHeaderSize, Qt::Uninitialized);
+    uchar *header = reinterpret_cast<uchar *>(res.data());
+    qToLittleEndian<quint32>(payload.size(), header);
+    qToLittleEndian<quint32>(crc32(0, reinterpret_cast<const Bytef *>(payload.constData()), payload.size()), header + 4);
+    res.append(payload);
+    return res;
+}
+
+QByteArray Journal::encodeIdNote(const QString &can, quint32 id, const QString &note)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << quint8(IdNote) << can << id << note;
+    return payload;
+}
+
+QByteArray Journal::encodeChangeNote(const QString &can, quint32 id, quint64 ts, const QString &note)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << quint8(ChangeNote) << can << id << ts << note;
+    return payload;
+}
+
+QByteArray Journal::encodeMask(const QString &can, quint32 id, quint8 length, quint64 mask)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << quint8(Mask) << can << id << length << mask;
+    return payload;
+}
+
+void Journal::append(const QByteArray &payload)
+{
+    apply(payload);
+    if(!_file.isOpen()) return;
+
+    QByteArray record = frame(payload);
+    if(_file.write(record) != record.size())
+    {
+        _broken = true;
+        fail(_file.errorString());
+    }
+    _records++;
+
+    _dirty = true;
+    if(!_commitTimer.isActive()) _commitTimer.start();
+}
+
+void Journal::logIdNote(const QString &can, quint32 id, const QString &note)
+{
+    append(encodeIdNote(can, id, note));
+}
+
+void Journal::logChangeNote(const QString &can, quint32 id, quint64 sec, quint32 usec, const QString &note)
+{
+    append(encodeChangeNote(can, id, sec * 1000000 + usec, note));
+}
+
+void Journal::logMask(const QString &can, quint32 id, quint8 length, quint64 mask)
+{
+    append(encodeMask(can, id, length, mask));
+}
+
+void Journal::logClearMasks()
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << quint8(ClearMasks);
+    append(payload);
+}
+
+void Journal::applyTo(CANMessage &msg) const
+{
+    QHash<Key, State>::const_iterator it = _state.constFind(Key(msg.can, msg.id));
+    if(it == _state.constEnd()) return;
+
+    if(it->hasNote && msg.note.isEmpty()) msg.note = it->note;
+    if(it->hasMask && (it->length == msg.length)) msg.bitmask = it->mask;
+}
+
+void Journal::applyChangeNotes(CANMessage &msg) const
+{
+    QHash<Key, State>::const_iterator it = _state.constFind(Key(msg.can, msg.id));
+    if((it == _state.constEnd()) || it->changeNotes.isEmpty()) return;
+
+    for(MessageLog &log : msg.changeLog)
+    {
+        if(!log.note.isEmpty()) continue;
+        log.note = it->changeNotes.value(log.sec * 1000000 + log.usec);
+    }
+}
+
+QByteArray Journal::maskDigest() const
+{
+    // in key order, hash order differs between runs
+    QList<Key> keys = _state.keys();
+    std::sort(keys.begin(), keys.end());
+    QByteArray masks;
+    QDataStream out(&masks, QIODevice::WriteOnly);
+    for(const Key &key : keys)
+    {
+        const State &state = _state[key];
+        if(state.hasMask) out << key.first << key.second << state.length << state.mask;
+    }
+    if(masks.isEmpty()) return QByteArray();
+    return QCryptographicHash::hash(masks, QCryptographicHash::Sha1);
+}
+
+int Journal::liveRecords() const
+{
+    int res = 0;
+    for(const State &state : _state)
+    {
+        res += (state.hasNote ? 1 : 0) + (state.hasMask ? 1 : 0) + state.changeNotes.size();
+    }
+    return res;
+}
+
+bool Journal::sync(QFileDevice &file)
+{
+    if(!file.flush()) return false;
+#if defined(Q_OS_LINUX)
+    return fdatasync(file.handle()) == 0;
+#elif defined(Q_OS_UNIX)
+    return fsync(file.handle()) == 0;
+#else
+    return true;
+#endif
+}
+
+bool Journal::commit()
+{
+    if(!_dirty) return true;
+    _dirty = false;
+    // a rewrite from the state in memory repairs an earlier failure
+    if(_broken) return compact();
+    if(!sync(_file))
+    {
+        _broken = true;
+        return fail(_file.errorString());
+    }
+    if((_records > compactMinRecords) && (_records > (4 * liveRecords()))) return compact();
+    return true;
+}
+
+bool Journal::fail(const QString &error)
+{
+    _errorString = error;
+    // retried with the next edit or close
+    _dirty = true;
+    emit errorOccurred(error);
+    return false;
+}
+
+// rewrites the journal with one record per live value
+bool Journal::compact()
+{
+    QSaveFile out(_file.fileName());
+    if(!out.open(QIODevice::WriteOnly))
+    {
+        _broken = true;
+        return fail(out.errorString());
+    }
+
+    int records = 0;
+    for(QHash<Key, State>::const_iterator it = _state.constBegin(); it != _state.constEnd(); ++it)
+    {
+        const QString &can = it.key().first;
+        quint32 id = it.key().second;
+        if(it->hasNote)
+        {
+            out.write(frame(encodeIdNote(can, id, it->note)));
+            records++;
+        }
+        if(it->hasMask)
+        {
+            out.write(frame(encodeMask(can, id, it->length, it->mask)));
+            records++;
+        }
+        for(QHash<quint64, QString>::const_iterator nt = it->changeNotes.constBegin(); nt != it->changeNotes.constEnd(); ++nt)
+        {
+            out.write(frame(encodeChangeNote(can, id, nt.key(), nt.value())));
+            records++;
+        }
+    }
+
+    // pending appends are part of the state written above
+    if(!sync(out) || !out.commit())
+    {
+        _broken = true;
+        return fail(out.errorString());
+    }
+
+    _file.close();
+    if(!_file.open(QIODevice::ReadWrite) || !_file.seek(_file.size()))
+    {
+        _broken = true;
+        return fail(_file.errorString());
+    }
+    _records = records;
+    _dirty = false;
+    _broken = false;
+    return true;
+}
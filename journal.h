@@ -0,0 +1,80 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QFile>
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QTimer>
+
+class CANMessage;
+
+// Append-only write-ahead log of notes and hand-edited masks.
+// Records are flushed and synced in groups, the file is compacted once it
+// is mostly superseded records.
+class Journal : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum RecordType { IdNote = 1, ChangeNote = 2, Mask = 3, ClearMasks = 4 };
+
+    explicit Journal(QObject *parent = nullptr);
+    ~Journal();
+
+    bool open(const QString &fname);
+    void close();
+    QString errorString() const { return _errorString; }
+
+    void logIdNote(const QString &can, quint32 id, const QString &note);
+    void logChangeNote(const QString &can, quint32 id, quint64 sec, quint32 usec, const QString &note);
+    void logMask(const QString &can, quint32 id, quint8 length, quint64 mask);
+    // drops every mask edited so far
+    void logClearMasks();
+
+    void applyTo(CANMessage &msg) const;
+    void applyChangeNotes(CANMessage &msg) const;
+    // changes with every mask edit, empty without masks
+    QByteArray maskDigest() const;
+
+public slots:
+    bool commit();
+    bool compact();
+
+signals:
+    // a write or sync failed, the edits are kept and rewritten on the next commit
+    void errorOccurred(const QString &error);
+
+private:
+    typedef QPair<QString, quint32> Key;
+    struct State
+    {
+        bool hasNote = false;
+        QString note;
+        bool hasMask = false;
+        quint8 length = 0;
+        quint64 mask = 0;
+        QHash<quint64, QString> changeNotes;
+    };
+
+    static QByteArray frame(const QByteArray &payload);
+    static QByteArray encodeIdNote(const QString &can, quint32 id, const QString &note);
+    static QByteArray encodeChangeNote(const QString &can, quint32 id, quint64 ts, const QString &note);
+    static QByteArray encodeMask(const QString &can, quint32 id, quint8 length, quint64 mask);
+    void append(const QByteArray &payload);
+    bool replay();
+    void apply(const QByteArray &payload);
+    int liveRecords() const;
+    static bool sync(QFileDevice &file);
+    bool fail(const QString &error);
+
+    QFile _file;
+    QString _errorString;
+    QHash<Key, State> _state;
+    QTimer _commitTimer;
+    int _records = 0;
+    bool _dirty = false;
+    bool _broken = false;       // the file may miss or tear records
+};
+
+#endif // JOURNAL_H
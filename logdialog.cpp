@@ -55,9 +55,16 @@ LogDialog::~LogDialog()
     delete ui;
 }
 
+void LogDialog::setReadOnly(bool val)
+{
+    ui->textNote->setReadOnly(val);
+    if(val) ui->tableWidget->setEditTriggers(QAbstractItemView::NoEditTriggers);
+}
+
 void LogDialog::on_textNote_textChanged()
 {
     _pmsg->note = ui->textNote->toPlainText();
+    if(_inited) emit noteChanged(_pmsg->note);
 }
 
 void LogDialog::on_tableWidget_itemChanged(QTableWidgetItem *item)
@@ -74,6 +81,7 @@ void LogDialog::on_tableWidget_itemChanged(QTableWidgetItem *item)
             if(i == ix)
             {
                 log.note = item->text();
+                emit changeNoteChanged(log.sec, log.usec, log.note);
                 break;
             }
             i++;
@@ -20,6 +20,13 @@ public:
     explicit LogDialog(QWidget *parent, CANMessage *pmsg);
     ~LogDialog();
 
+    // notes of mirrored rows are not editable
+    void setReadOnly(bool val);
+
+signals:
+    void noteChanged(const QString &note);
+    void changeNoteChanged(quint64 sec, quint32 usec, const QString &note);
+
 private slots:
     void on_textNote_textChanged();
 
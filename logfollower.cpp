@@ -0,0 +1,83 @@
+#include "logfollower.h"
+#include "logmodel.h"
+#include "tracer.h"
+
+// catching up on a long log takes the same batches as loading it
+const int followBatch = 16384;
+// coalesces the burst of notifications a writer produces
+const int followDebounceMs = 100;
+// a file replaced by rename is missing for a moment and drops out of the watcher
+const int rewatchMs = 500;
+
+LogFollower::LogFollower(LogModel *model, QObject *parent)
+    :QObject(parent), _reader(model->buses())
+{
+    _model = model;
+    _frames.resize(followBatch);
+
+    _debounce.setSingleShot(true);
+    _debounce.setInterval(followDebounceMs);
+    connect(&_debounce, &QTimer::timeout, this, &LogFollower::poll);
+    _rewatch.setInterval(rewatchMs);
+    connect(&_rewatch, &QTimer::timeout, this, &LogFollower::poll);
+    connect(&_watcher, &QFileSystemWatcher::fileChanged, this, &LogFollower::onFileChanged);
+}
+
+bool LogFollower::start(const QString &fname)
+{
+    stop();
+    if(!_reader.open(fname)) return false;
+
+    _fname = fname;
+    _reader.setFollow(true);
+    _model->loadFrames(&_reader);
+    watch();
+    return true;
+}
+
+void LogFollower::stop()
+{
+    _debounce.stop();
+    _rewatch.stop();
+    if(!_watcher.files().isEmpty()) _watcher.removePaths(_watcher.files());
+    _fname.clear();
+}
+
+void LogFollower::onFileChanged()
+{
+    if(!_debounce.isActive()) _debounce.start();
+}
+
+void LogFollower::poll()
+{
+    if(_fname.isEmpty()) return;
+    TRACE_SCOPE("LogFollower::poll");
+
+    watch();
+
+    if(!_reader.resume())
+    {
+        // truncated or rotated, the new content continues the log
+        if(!_reader.resume()) return;
+        emit restarted();
+    }
+
+    int count;
+    while((count = _reader.read(_frames.data(), followBatch)) > 0)
+    {
+        _model->procFrames(_frames.constData(), count);
+    }
+}
+
+// a replaced file drops out of the watch list, and cannot be added while missing
+void LogFollower::watch()
+{
+    if(_watcher.files().contains(_fname) || _watcher.addPath(_fname))
+    {
+        _rewatch.stop();
+    }
+    else if(!_rewatch.isActive())
+    {
+        _rewatch.start();
+    }
+}
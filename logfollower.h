@@ -0,0 +1,43 @@
+#ifndef LOGFOLLOWER_H
+#define LOGFOLLOWER_H
+
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QTimer>
+#include "framereader.h"
+
+class LogModel;
+
+// Keeps a growing candump log loaded, only appended lines are parsed.
+class LogFollower : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LogFollower(LogModel *model, QObject *parent = nullptr);
+
+    bool start(const QString &fname);
+    void stop();
+    QString fileName() const { return _fname; }
+    QString errorString() const { return _reader.errorString(); }
+
+signals:
+    void restarted();
+
+private slots:
+    void onFileChanged();
+    void poll();
+
+private:
+    void watch();
+
+    LogModel *_model = nullptr;
+    CandumpReader _reader;
+    QFileSystemWatcher _watcher;
+    QTimer _debounce;
+    QTimer _rewatch;    // polls while the file is missing and unwatched
+    QString _fname;
+    QVector<CANFrame> _frames;
+};
+
+#endif // LOGFOLLOWER_H
@@ -1,24 +1,34 @@
 #include "logmodel.h"
-#include <QFile>
-#include <QRegularExpression>
-#include <QRegularExpressionMatch>
 #include <QDebug>
+#include <QScopedPointer>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include "journal.h"
 #include "logdialog.h"
-
-const QRegularExpression logReg("^\\((\\d+).(\\d+)\\)\\s(\\w+)\\s([0-9a-f]+)#([0-9a-f]*)$", QRegularExpression::CaseInsensitiveOption);
-
-CANMessage::CANMessage(const QString &can, quint32 id, const QByteArray &data)
+#include "mergedreader.h"
+#include "sidecarindex.h"
+#include "tracer.h"
+
+const int frameBatch = 16384;
+// below this a batch is cheaper on the calling thread; a frame costs about
+// 250 ns and waking and joining a worker about 6 us. Live sources hand over
+// far smaller batches and far fewer frames than one thread keeps up with,
+// loads and Follow catching up on a log come in full batches.
+const size_t parallelMinFrames = 1024;
+const int maxShards = 16;
+// a mask edit re-reads at most this much of an indexed log for its ID
+const qint64 relogMaxBytes = 64 * 1024 * 1024;
+
+CANMessage::CANMessage(const QString &can, const CANFrame &frame)
 {
     status = None;
     this->can = can;
-    this->id = id;
-    setLength(data.length());
-    this->data = 0;
-    for(int i = 0; i < length; i++)
-    {
-        this->data <<= 8;
-        this->data |= (quint8)data[i];
-    }
+    this->bus = frame.bus;
+    this->id = frame.id;
+    setLength(qMin<quint8>(frame.length, 8));
+    this->data = frame.payload();
+    known = detector.feed(data, length);
 }
 
 void CANMessage::setLength(quint8 len)
@@ -36,12 +46,65 @@ void CANMessage::setLength(quint8 len)
     data = 0;
     bitmask = mask;
     chbits = 0;
+    known = 0;
+    detector.reset();
+    clearLog();
+}
+
+void CANMessage::clearLog()
+{
     changeLog.clear();
+    changes.clear();
+    logEpoch++;
+}
+
+CANMessage::Result CANMessage::update(const CANFrame &frame, bool logChange, bool genMask)
+{
+    quint8 len = qMin<quint8>(frame.length, 8);
+    if(length != len)
+    {
+        setLength(len);
+    }
+
+    quint64 bdata = frame.payload();
+
+    // match
+    if(data == bdata) return Same;
+
+    quint64 newKnown = detector.feed(bdata, length);
+    if(newKnown != known)
+    {
+        known = newKnown;
+        chbits &= ~newKnown;
+    }
+
+    Result res = Updated;
+    if(logChange)
+    {
+        quint64 change = ((data ^ bdata) & bitmask & ~known);
+        if(change > 0)
+        {
+            chbits |= change;
+            status = Changes;
+            changeLog.append(MessageLog(frame.sec, frame.usec, bdata));
+            changes.append(frame.timestamp(), change);
+            res = Logged;
+        }
+    }
+    else if(genMask)
+    {
+        // noise log
+        bitmask &= ~(data ^ bdata);
+    }
+    data = bdata;
+    return res;
 }
 
 LogModel::LogModel(QObject *parent)
     :QAbstractTableModel(parent)
 {
+    setThreads(QThread::idealThreadCount());
+    connect(this, &QAbstractItemModel::dataChanged, [this]() { _stats.add(PipelineStats::DataChanged); });
 }
 
 int LogModel::rowCount(const QModelIndex&) const
@@ -56,6 +119,7 @@ int LogModel::columnCount(const QModelIndex&) const
 
 QVariant LogModel::data(const QModelIndex &index, int role) const
 {
+    TRACE_SCOPE("LogModel::data");
     if(!index.isValid()) return QVariant();
 
     if((role == Qt::DisplayRole) || (role == Qt::EditRole))
@@ -73,8 +137,8 @@ QVariant LogModel::data(const QModelIndex &index, int role) const
             if(role == Qt::EditRole) return QString("%1").arg(msg.bitmask, msg.length * 2, 16, QChar('0'));
             return toHex(msg.bitmask, msg.length);
         case CHBITS:
-            if(role == Qt::EditRole) return QString("%1").arg(msg.chbits, msg.length * 2, 16, QChar('0'));
-            return toHex(msg.chbits, msg.length);
+            if(role == Qt::EditRole) return QString("%1").arg(changingBits(msg), msg.length * 2, 16, QChar('0'));
+            return toHex(changingBits(msg), msg.length);
         case CHCNT:
             return QString::number(msg.changeLog.size(), 10);
         case NOTE:
@@ -117,9 +181,11 @@ QVariant LogModel::data(const QModelIndex &index, int role) const
         case DATA:
             return toBin(msg.data, msg.length);
         case BITMASK:
+            if(msg.known) return QString("%1\nknown: %2\n%3").arg(toBin(msg.bitmask, msg.length))
+                                 .arg(toBin(msg.known, msg.length)).arg(msg.detector.describe());
             return toBin(msg.bitmask, msg.length);
         case CHBITS:
-            return toBin(msg.chbits, msg.length);
+            return toBin(changingBits(msg), msg.length);
 //        case CHCNT:
 //        {
 //            QString res;
@@ -173,6 +239,7 @@ QVariant LogModel::headerData(int section, Qt::Orientation orientation, int role
 Qt::ItemFlags LogModel::flags(const QModelIndex &index) const
 {
     if(!index.isValid()) return Qt::ItemIsEnabled;
+    if(_readOnly) return (Qt::ItemIsSelectable | Qt::ItemIsEnabled);
 
     if((index.column() == CAN) || (index.column() == ID)
             || (index.column() == BITMASK) || (index.column() == NOTE))
@@ -184,7 +251,7 @@ Qt::ItemFlags LogModel::flags(const QModelIndex &index) const
 
 bool LogModel::setData(const QModelIndex &index, const QVariant &value, int role)
 {
-    if(!index.isValid()) return false;
+    if(!index.isValid() || _readOnly) return false;
 
     if(role == Qt::EditRole)
     {
@@ -200,11 +267,14 @@ bool LogModel::setData(const QModelIndex &index, const QVariant &value, int role
 
             _msgs[index.row()].setLength(len);
             _msgs[index.row()].bitmask = newMask;
-            if((_msgs[index.row()].chbits & newMask) != _msgs[index.row()].chbits)
+            // an indexed log replays the ID under the new mask, otherwise
+            // the history goes once it has bits outside the mask
+            if(!relogIndexed(index.row()) && ((_msgs[index.row()].chbits & newMask) != _msgs[index.row()].chbits))
             {
                 _msgs[index.row()].chbits = 0;
-                _msgs[index.row()].changeLog.clear();
+                _msgs[index.row()].clearLog();
             }
+            if(_journal) _journal->logMask(_msgs[index.row()].can, _msgs[index.row()].id, _msgs[index.row()].length, newMask);
             emit dataChanged(createIndex(index.row(), 0), createIndex(index.row(), END - 1));
             return true;
         }
@@ -221,7 +291,10 @@ bool LogModel::setData(const QModelIndex &index, const QVariant &value, int role
                     return false;
             }
             _msgs[index.row()].can = newCan;
+            _msgs[index.row()].bus = newCan.isEmpty() ? quint16(BusTable::NoBus) : _buses.handle(newCan);
             _msgs[index.row()].setLength(0);
+            rebuildIndex();
+            _generation++;
             emit dataChanged(createIndex(index.row(), 0), createIndex(index.row(), END - 1));
             return true;
         }
@@ -239,12 +312,15 @@ bool LogModel::setData(const QModelIndex &index, const QVariant &value, int role
             }
             _msgs[index.row()].id = newID;
             _msgs[index.row()].setLength(0);
+            rebuildIndex();
+            _generation++;
             emit dataChanged(createIndex(index.row(), 0), createIndex(index.row(), END - 1));
             return true;
         }
         else if(index.column() == NOTE)
         {
             _msgs[index.row()].note = value.toString();
+            if(_journal) _journal->logIdNote(_msgs[index.row()].can, _msgs[index.row()].id, _msgs[index.row()].note);
             emit dataChanged(index, index);
         }
     }
@@ -254,12 +330,15 @@ bool LogModel::setData(const QModelIndex &index, const QVariant &value, int role
 
 bool LogModel::insertRows(int row, int count, const QModelIndex&)
 {
+    if(_readOnly) return false;
     beginInsertRows(QModelIndex(), row, row + count - 1);
 
     for(int i = 0; i < count; i++)
     {
         _msgs.insert(row, CANMessage());
     }
+    rebuildIndex();
+    _generation++;
 
     endInsertRows();
     return true;
@@ -267,9 +346,12 @@ bool LogModel::insertRows(int row, int count, const QModelIndex&)
 
 bool LogModel::removeRows(int row, int count, const QModelIndex&)
 {
+    if(_readOnly) return false;
     beginRemoveRows(QModelIndex(), row, row + count - 1);
 
     _msgs.remove(row, count);
+    rebuildIndex();
+    _generation++;
 
     endRemoveRows();
     return true;
@@ -277,29 +359,227 @@ bool LogModel::removeRows(int row, int count, const QModelIndex&)
 
 void LogModel::loadLog(QString fname)
 {
-    QFile file(fname);
-    if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    TRACE_SCOPE("loadLog");
+    // checkpoints hold the state of this log alone
+    bool indexed = _useIndex && _msgs.isEmpty();
+    _indexedLog.clear();
+    if(indexed && reopenIndexed(fname)) return;
+
+    QScopedPointer<FrameReader> reader(FrameReader::create(fname, &_buses));
+    if(!reader->open(fname))
         return;
 
-    while(!file.atEnd())
+    if(indexed && reader->seekable())
     {
-        QByteArray line = file.readLine();
-        QRegularExpressionMatch match = logReg.match(line);
-        if(match.hasMatch())
+        SidecarIndex index;
+        index.setInterval(_indexInterval);
+        if(index.create(fname, &_buses, indexSettings()))
         {
-            QString ssec = match.captured(1);
-            QString susec = match.captured(2);
-            QString can = match.captured(3);
-            QString sid = match.captured(4);
-            QString sdata = match.captured(5);
+            loadFrames(reader.data(), &index);
+            if(index.finish(*this))
+            {
+                _indexedLog = fname;
+                _indexedFirst = _firstTimestamp;
+                _indexedLast = _lastTimestamp;
+            }
+            else
+            {
+                qWarning() << index.errorString();
+            }
+            return;
+        }
+        qWarning() << index.errorString();
+    }
+    loadFrames(reader.data());
+}
 
-            QByteArray data = QByteArray::fromHex(sdata.toUtf8());
+// checkpoints written under other modes or masks would restore another state
+bool LogModel::openIndex(SidecarIndex &index, const QString &fname) const
+{
+    if(!index.open(fname))
+    {
+        if(QFile::exists(SidecarIndex::path(fname))) qWarning() << index.errorString();
+        return false;
+    }
+    if(index.settings() != indexSettings())
+    {
+        qWarning() << "Log indexed with other modes or masks, not using" << SidecarIndex::path(fname);
+        return false;
+    }
+    return true;
+}
+
+// restores the final checkpoint instead of parsing the log
+bool LogModel::reopenIndexed(const QString &fname)
+{
+    SidecarIndex index;
+    if(!openIndex(index, fname)) return false;
+
+    qint64 offset;
+    if(!restoreCheckpoint(index, index.checkpoints() - 1, offset))
+    {
+        qWarning() << "Cannot restore" << SidecarIndex::path(fname);
+        if(!_msgs.isEmpty()) clearAll();
+        return false;
+    }
+    _indexedLog = fname;
+    _indexedFirst = index.firstTimestamp();
+    _indexedLast = index.lastTimestamp();
+    emit progressValue(100);
+    return true;
+}
 
-            procMessage(ssec.toULong(), susec.toUInt(), can, sid.toUInt(nullptr, 16), data, false);
+// replays checkpoints 0..ix, each adds the change log entries since the one before
+bool LogModel::restoreCheckpoint(SidecarIndex &index, int ix, qint64 &logOffset)
+{
+    if(!_msgs.isEmpty()) clearAll();
+    logOffset = 0;
+    for(int i = 0; i <= ix; i++)
+    {
+        RemoteUpdate state;
+        QVector<SignalDetector> detectors;
+        if(!index.checkpoint(i, state, detectors, logOffset)) return false;
+        state.generation = _remoteGeneration;
+        applyRemote(state, &detectors);
+    }
+    return true;
+}
+
+// state of the indexed log at ts, from the nearest checkpoint on
+bool LogModel::seekTo(quint64 ts)
+{
+    TRACE_SCOPE("seekTo");
+    // restoring clears the model, the log stays seekable
+    QString log = _indexedLog;
+    if(log.isEmpty()) return false;
+
+    SidecarIndex index;
+    if(!openIndex(index, log)) return false;
+    QScopedPointer<FrameReader> reader(FrameReader::create(log, &_buses));
+    if(!reader->open(log)) return false;
+
+    qint64 offset;
+    bool restored = restoreCheckpoint(index, index.nearest(ts), offset);
+    _indexedLog = log;
+    if(!restored || !reader->seek(offset)) return false;
+
+    QVector<CANFrame> frames(frameBatch);
+    int count;
+    while((count = reader->read(frames.data(), frameBatch)) > 0)
+    {
+        int n = 0;
+        while((n < count) && (frames[n].timestamp() < ts)) n++;
+        procFrames(frames.constData(), n, false);
+        if(n < count) break;
+    }
+    if(!_msgs.isEmpty()) emit dataChanged(createIndex(0, 0), createIndex(_msgs.size() - 1, END - 1));
+    return true;
+}
+
+SidecarIndex::Settings LogModel::indexSettings() const
+{
+    SidecarIndex::Settings res;
+    res.logChange = _logChange;
+    res.genMask = _genMask;
+    res.filtering = _filtering;
+    // rows get journaled masks when they are first seen
+    if(_journal) res.masks = _journal->maskDigest();
+    return res;
+}
+
+// rebuilds the change log of a row under its current mask, reading only the
+// batches of the indexed log its ID shows up in, up to the model's last frame
+bool LogModel::relogIndexed(int row)
+{
+    CANMessage &msg = _msgs[row];
+    if(_indexedLog.isEmpty() || !_logChange || (msg.bus == BusTable::NoBus)) return false;
+
+    TRACE_SCOPE("relogIndexed");
+    SidecarIndex index;
+    if(!index.open(_indexedLog)) return false;
+    QScopedPointer<FrameReader> reader(FrameReader::create(_indexedLog, &_buses));
+    if(!reader->open(_indexedLog)) return false;
+
+    QVector<SidecarIndex::Range> ranges = index.ranges(msg.can, msg.id);
+    qint64 bytes = 0;
+    for(const SidecarIndex::Range &range : ranges) bytes += range.end - range.start;
+    if(bytes > relogMaxBytes) return false;
+
+    // the row as a load would have built it, from the ID's first frame on
+    CANMessage replay;
+    bool seen = false;
+    bool done = false;
+    QVector<CANFrame> frames(frameBatch);
+    for(int r = 0; (r < ranges.size()) && !done; r++)
+    {
+        if(!reader->seek(ranges[r].start)) return false;
+        int count;
+        while(!done && (reader->pos() < ranges[r].end) && ((count = reader->read(frames.data(), frameBatch)) > 0))
+        {
+            for(int i = 0; (i < count) && !done; i++)
+            {
+                const CANFrame &frame = frames[i];
+                if((frame.bus != msg.bus) || (frame.id != msg.id)) continue;
+                // a seek left the model short of the end of the log
+                done = (frame.timestamp() > _lastTimestamp);
+                if(done) break;
+                if(seen)
+                {
+                    replay.update(frame, true, false);
+                    continue;
+                }
+                replay = CANMessage(msg.can, frame);
+                // the mask only holds for the length it was set for
+                if(replay.length != msg.length) return false;
+                replay.bitmask = msg.bitmask;
+                seen = true;
+            }
         }
-        int percent = (file.pos() * 99 / file.size()) + 1;
+    }
+    if(!seen) return false;
+
+    msg.chbits = replay.chbits;
+    msg.changeLog = replay.changeLog;
+    msg.changes = replay.changes;
+    msg.logEpoch++;
+    return true;
+}
+
+// several logs are merged into one time-ordered stream
+void LogModel::loadLogs(const QStringList &fnames)
+{
+    _indexedLog.clear();
+    if(fnames.size() == 1)
+    {
+        loadLog(fnames.first());
+        return;
+    }
+
+    TRACE_SCOPE("loadLogs");
+    MergedReader reader(&_buses);
+    if(!reader.open(fnames))
+    {
+        qWarning() << reader.errorString();
+        return;
+    }
+
+    loadFrames(&reader);
+}
+
+void LogModel::loadFrames(FrameReader *reader, SidecarIndex *index)
+{
+    QVector<CANFrame> frames(frameBatch);
+    int count;
+    qint64 start = reader->pos();
+    while((count = reader->read(frames.data(), frameBatch)) > 0)
+    {
+        procFrames(frames.constData(), count, false);
+        if(index) index->addBatch(frames.constData(), count, start, reader->pos(), *this);
+        start = reader->pos();
+        int percent = (reader->size() > 0) ? ((reader->pos() * 99 / reader->size()) + 1) : 100;
         emit progressValue(percent);
     }
+    TRACE_SCOPE("dataChanged");
     emit dataChanged(createIndex(0, 0), createIndex(_msgs.size() - 1, END - 1));
 }
 
@@ -307,6 +587,12 @@ void LogModel::clearAll()
 {
     beginRemoveRows(QModelIndex(), 0, _msgs.size() - 1);
     _msgs.clear();
+    for(Shard &shard : _shards) shard.index.clear();
+    _markers.clear();
+    _firstTimestamp = 0;
+    _lastTimestamp = 0;
+    _indexedLog.clear();
+    _generation++;
     endRemoveRows();
 }
 
@@ -325,6 +611,7 @@ void LogModel::clearMasks()
     {
         _msgs[i].bitmask = _msgs[i].mask;
     }
+    if(_journal) _journal->logClearMasks();
     emit dataChanged(createIndex(0, 0), createIndex(_msgs.size() - 1, END - 1));
 }
 
@@ -333,7 +620,7 @@ void LogModel::clearChanges()
     for(int i = 0; i < _msgs.size(); i++)
     {
         _msgs[i].chbits = 0;
-        _msgs[i].changeLog.clear();
+        _msgs[i].clearLog();
     }
     emit dataChanged(createIndex(0, 0), createIndex(_msgs.size() - 1, END - 1));
 }
@@ -344,67 +631,358 @@ void LogModel::onDoubleClicked(const QModelIndex &index)
 
     if(index.column() == CHCNT)
     {
-        LogDialog dlg(NULL, &_msgs[index.row()]);
+        CANMessage &msg = _msgs[index.row()];
+        if(_journal) _journal->applyChangeNotes(msg);
+        LogDialog dlg(NULL, &msg);
+        dlg.setReadOnly(_readOnly);
+        if(_journal)
+        {
+            connect(&dlg, &LogDialog::changeNoteChanged, [this, &msg](quint64 sec, quint32 usec, const QString &note)
+            {
+                _journal->logChangeNote(msg.can, msg.id, sec, usec, note);
+            });
+        }
+        // the note editor changes msg.note per keystroke, journaled once at the end
+        QString note = msg.note;
         dlg.exec();
+        if(_journal && (msg.note != note)) _journal->logIdNote(msg.can, msg.id, msg.note);
         emit dataChanged(createIndex(index.row(), 0), createIndex(index.row(), END - 1));
     }
 }
 
-void LogModel::procMessage(quint64 sec, quint32 usec, const QString &can, quint32 id, const QByteArray &data, bool update)
+void LogModel::procFrames(const CANFrame *frames, size_t count, bool update)
 {
-    bool found = false;
-    for(int i = 0; i < _msgs.size(); i++)
+    TRACE_SCOPE("procFrames");
+    if(count == 0) return;
+
+    _stats.add(PipelineStats::FramesIn, count);
+    if(!_firstTimestamp) _firstTimestamp = frames[0].timestamp();
+    _lastTimestamp = frames[count - 1].timestamp();
+
+    // frames keep their order within a shard, so per-ID order is kept
+    for(Shard &shard : _shards)
     {
-        const CANMessage &msg = _msgs[i];
-        if((msg.can.isEmpty() || (msg.can == can)) && (msg.id == id))
+        shard.frames.clear();
+        shard.first = _msgs.size();
+        shard.last = -1;
+        shard.logged = 0;
+        shard.filtered = 0;
+    }
+    for(size_t i = 0; i < count; i++)
+    {
+        _shards[shardOf(frames[i].id)].frames.append(i);
+    }
+
+    // detach here once, the workers write through the raw pointer
+    CANMessage *rows = _msgs.data();
+    if((_shards.size() > 1) && (count >= parallelMinFrames))
+    {
+        QtConcurrent::blockingMap(_shards, [this, frames, rows](Shard &shard) { procShard(shard, frames, rows); });
+    }
+    else
+    {
+        for(Shard &shard : _shards) procShard(shard, frames, rows);
+    }
+
+    mergeShards(update);
+}
+
+// may run on a worker thread, touches only the rows of its own IDs
+void LogModel::procShard(Shard &shard, const CANFrame *frames, CANMessage *rows) const
+{
+    if(shard.frames.isEmpty()) return;
+
+    TRACE_SCOPE("procShard");
+    for(quint32 pos : shard.frames)
+    {
+        const CANFrame &frame = frames[pos];
+        QHash<quint64, int>::iterator it = shard.index.find(indexKey(frame.bus, frame.id));
+        if(it == shard.index.end())
         {
-            if(msg.can.isEmpty()) _msgs[i].can = can;
-            if(msg.length != data.length())
+            // rows added by hand match any bus
+            it = shard.index.find(indexKey(BusTable::NoBus, frame.id));
+            if(it != shard.index.end())
             {
-                _msgs[i].setLength(data.length());
+                int i = it.value();
+                CANMessage &msg = (i >= 0) ? rows[i] : shard.pending[-i - 1];
+                msg.bus = frame.bus;
+                msg.can = _buses.name(frame.bus);
+                shard.index.erase(it);
+                it = shard.index.insert(indexKey(frame.bus, frame.id), i);
             }
+        }
 
-            quint64 bdata = 0;
-            for(int i = 0; i < data.length(); i++)
+        if(it != shard.index.end())
+        {
+            int i = it.value();
+            CANMessage &msg = (i >= 0) ? rows[i] : shard.pending[-i - 1];
+            CANMessage::Result res = msg.update(frame, _logChange, _genMask);
+            if(res == CANMessage::Logged) shard.logged++;
+            if((res != CANMessage::Same) && (i >= 0))
             {
-                bdata <<= 8;
-                bdata |= (quint8)data[i];
+                shard.first = qMin(shard.first, i);
+                shard.last = qMax(shard.last, i);
             }
+        }
+        else if(!_filtering)
+        {
+            CANMessage msg(_buses.name(frame.bus), frame);
+            msg.status = CANMessage::New;
+            if(_journal) _journal->applyTo(msg);
+            shard.pending.append(msg);
+            shard.pendingSeq.append(pos);
+            // pending rows are numbered from -1 down until the merge
+            shard.index.insert(indexKey(frame.bus, frame.id), -shard.pending.size());
+        }
+        else
+        {
+            shard.filtered++;
+        }
+    }
+}
 
-            // match
-            found = true;
-            if(msg.data != bdata)
-            {
-                if(_logChange)
-                {
-                    quint64 change = ((msg.data ^ bdata) & msg.bitmask);
-                    if(change > 0)
-                    {
-                        _msgs[i].chbits |= change;
-                        _msgs[i].status = CANMessage::Changes;
-                        MessageLog chlog(sec, usec, bdata);
-                        _msgs[i].changeLog.append(chlog);
-                    }
-                }
-                else if(_genMask)
-                {
-                    // noise log
-                    _msgs[i].bitmask &= ~(msg.data ^ bdata);
-                }
-                _msgs[i].data = bdata;
-                if(update) emit dataChanged(createIndex(i, 0), createIndex(i, END - 1));
-            }
-            break;
+// publishes the results of a batch, on the GUI thread
+void LogModel::mergeShards(bool update)
+{
+    int first = _msgs.size();
+    int last = -1;
+    int added = 0;
+    for(const Shard &shard : _shards)
+    {
+        first = qMin(first, shard.first);
+        last = qMax(last, shard.last);
+        added += shard.pending.size();
+        _stats.add(PipelineStats::ChangesLogged, shard.logged);
+        _stats.add(PipelineStats::FramesFiltered, shard.filtered);
+    }
+    if(update && (last >= first))
+    {
+        TRACE_SCOPE("dataChanged");
+        emit dataChanged(createIndex(first, 0), createIndex(last, END - 1));
+    }
+    if(added == 0) return;
+
+    // new rows in first-seen order, as one thread would have added them
+    struct NewRow
+    {
+        quint32 seq;
+        int shard;
+        int ix;
+    };
+    QVector<NewRow> order;
+    order.reserve(added);
+    for(int s = 0; s < _shards.size(); s++)
+    {
+        for(int k = 0; k < _shards[s].pending.size(); k++) order.append({ _shards[s].pendingSeq[k], s, k });
+    }
+    std::sort(order.begin(), order.end(), [](const NewRow &a, const NewRow &b) { return a.seq < b.seq; });
+
+    TRACE_SCOPE("insertRows");
+    beginInsertRows(QModelIndex(), _msgs.size(), _msgs.size() + added - 1);
+    _msgs.reserve(_msgs.size() + added);
+    for(const NewRow &row : order)
+    {
+        Shard &shard = _shards[row.shard];
+        CANMessage &msg = shard.pending[row.ix];
+        shard.index.insert(indexKey(msg.bus, msg.id), _msgs.size());
+        _msgs.append(std::move(msg));
+    }
+    for(Shard &shard : _shards)
+    {
+        shard.pending.clear();
+        shard.pendingSeq.clear();
+    }
+    endInsertRows();
+    _stats.add(PipelineStats::NewIDs, added);
+}
+
+void LogModel::setTimeWindow(quint64 from, quint64 to)
+{
+    _windowed = true;
+    _windowFrom = from;
+    _windowTo = to;
+    emit dataChanged(createIndex(0, CHBITS), createIndex(_msgs.size() - 1, CHBITS));
+}
+
+void LogModel::clearTimeWindow()
+{
+    _windowed = false;
+    emit dataChanged(createIndex(0, CHBITS), createIndex(_msgs.size() - 1, CHBITS));
+}
+
+quint64 LogModel::changingBits(const CANMessage &msg) const
+{
+    if(!_windowed) return msg.chbits;
+    // known bits may have been logged before the detector confirmed them
+    return msg.changes.bits(_windowFrom, _windowTo) & ~msg.known;
+}
+
+void LogModel::setThreads(int count)
+{
+    // rows move to the shard of their ID under the new count
+    _shards.resize(qBound(1, count, maxShards));
+    rebuildIndex();
+}
+
+void LogModel::rebuildIndex()
+{
+    for(Shard &shard : _shards) shard.index.clear();
+    for(int i = 0; i < _msgs.size(); i++)
+    {
+        QHash<quint64, int> &index = _shards[shardOf(_msgs[i].id)].index;
+        quint64 key = indexKey(_msgs[i].bus, _msgs[i].id);
+        // first row wins, like the linear search did
+        if(!index.contains(key)) index.insert(key, i);
+    }
+}
+
+// the row and its change log entries from changeBase on
+RemoteRow LogModel::exportRow(int row, quint32 changeBase) const
+{
+    const CANMessage &msg = _msgs[row];
+    RemoteRow res;
+    res.can = msg.can;
+    res.id = msg.id;
+    res.length = msg.length;
+    res.status = msg.status;
+    res.data = msg.data;
+    res.bitmask = msg.bitmask;
+    res.chbits = msg.chbits;
+    res.known = msg.known;
+
+    quint32 count = msg.changeLog.size();
+    // the log was cleared since
+    if(changeBase > count) changeBase = 0;
+    res.changeBase = changeBase;
+    if(changeBase == count) return res;
+
+    const QVector<quint64> &deltas = msg.changes.deltas();
+    QLinkedList<MessageLog>::const_iterator it = msg.changeLog.constEnd();
+    for(quint32 k = count; k > changeBase; k--) --it;
+    res.changes.reserve(count - changeBase);
+    for(quint32 k = changeBase; k < count; k++, ++it)
+    {
+        RemoteChange change;
+        change.sec = it->sec;
+        change.usec = it->usec;
+        change.data = it->data;
+        change.delta = deltas[k];
+        res.changes.append(change);
+    }
+    return res;
+}
+
+void LogModel::applyRemote(const RemoteUpdate &update, const QVector<SignalDetector> *detectors)
+{
+    TRACE_SCOPE("applyRemote");
+    if(update.snapshot)
+    {
+        if(!_msgs.isEmpty()) clearAll();
+        _remoteGeneration = update.generation;
+    }
+    else if(update.generation != _remoteGeneration)
+    {
+        // stale delta, a snapshot of the new generation follows
+        return;
+    }
+    _firstTimestamp = update.firstTimestamp;
+    _lastTimestamp = update.lastTimestamp;
+
+    int first = _msgs.size();
+    int last = -1;
+    QVector<CANMessage> added;
+    for(int i = 0; i < update.rows.size(); i++)
+    {
+        const RemoteRow &row = update.rows[i];
+        quint16 bus = _buses.handle(row.can);
+        const QHash<quint64, int> &index = _shards[shardOf(row.id)].index;
+        QHash<quint64, int>::const_iterator it = index.constFind(indexKey(bus, row.id));
+        CANMessage *msg;
+        if(it != index.constEnd())
+        {
+            msg = &_msgs[it.value()];
+            first = qMin(first, it.value());
+            last = qMax(last, it.value());
+        }
+        else
+        {
+            added.append(CANMessage());
+            msg = &added.last();
+            msg->can = row.can;
+            msg->bus = bus;
+            msg->id = row.id;
+        }
+
+        msg->setLength(row.length);
+        msg->status = CANMessage::Status(row.status);
+        msg->data = row.data;
+        msg->bitmask = row.bitmask;
+        msg->chbits = row.chbits;
+        msg->known = row.known;
+        // the server sends the whole log again after clearing it
+        if(row.changeBase == 0)
+        {
+            msg->clearLog();
+        }
+        for(const RemoteChange &change : row.changes)
+        {
+            msg->changeLog.append(MessageLog(change.sec, change.usec, change.data));
+            msg->changes.append(change.sec * 1000000 + change.usec, change.delta);
         }
+        if(detectors) msg->detector = detectors->at(i);
     }
-    if((!found) && (!_filtering))
+
+    if(last >= first)
     {
-        CANMessage msg(can, id, data);
-        msg.status = CANMessage::New;
-        beginInsertRows(QModelIndex(), _msgs.size(), _msgs.size());
-        _msgs.append(msg);
-        endInsertRows();
+        emit dataChanged(createIndex(first, 0), createIndex(last, END - 1));
     }
+    if(added.isEmpty()) return;
+
+    beginInsertRows(QModelIndex(), _msgs.size(), _msgs.size() + added.size() - 1);
+    for(CANMessage &msg : added)
+    {
+        // rows carry no notes, and checkpoints predate later mask edits;
+        // the server owns the masks of attached GUIs
+        if(_journal)
+        {
+            quint64 bitmask = msg.bitmask;
+            _journal->applyTo(msg);
+            if(_readOnly) msg.bitmask = bitmask;
+        }
+        _shards[shardOf(msg.id)].index.insert(indexKey(msg.bus, msg.id), _msgs.size());
+        _msgs.append(std::move(msg));
+    }
+    endInsertRows();
+}
+
+QVector<CorrelationCandidate> LogModel::correlate(quint64 before, quint64 after) const
+{
+    TRACE_SCOPE("correlate");
+    QVector<const CANMessage *> msgs;
+    msgs.reserve(_msgs.size());
+    for(int i = 0; i < _msgs.size(); i++) msgs.append(&_msgs[i]);
+
+    Correlator correlator(_markers, before, after, _firstTimestamp, _lastTimestamp);
+    return correlator.run(msgs);
+}
+
+quint64 LogModel::memoryUsage() const
+{
+    // rough estimate, QLinkedList nodes carry two extra pointers
+    quint64 res = _msgs.capacity() * sizeof(CANMessage);
+    for(int i = 0; i < _msgs.size(); i++)
+    {
+        const CANMessage &msg = _msgs[i];
+        res += msg.changeLog.size() * (sizeof(MessageLog) + 2 * sizeof(void *));
+        // arrival order is copied once timestamps went backwards
+        res += msg.changes.size() * (msg.changes.ordered() ? 4 : 6) * sizeof(quint64);
+        res += (msg.can.capacity() + msg.note.capacity()) * sizeof(QChar);
+    }
+    for(const Shard &shard : _shards)
+    {
+        res += shard.index.size() * (sizeof(quint64) + sizeof(int) + 2 * sizeof(void *));
+    }
+    return res;
 }
 
 QString toHex(quint64 value, quint8 length)
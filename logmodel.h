@@ -2,7 +2,18 @@
 #define LOGMODEL_H
 
 #include <QAbstractTableModel>
+#include <QHash>
 #include <QLinkedList>
+#include "canframe.h"
+#include "changeindex.h"
+#include "framereader.h"
+#include "pipelinestats.h"
+#include "correlator.h"
+#include "signaldetector.h"
+#include "remoteprotocol.h"
+#include "sidecarindex.h"
+
+class Journal;
 
 class MessageLog
 {
@@ -25,13 +36,17 @@ class CANMessage
 {
 public:
     enum Status { None, New, Changes };
+    enum Result { Same, Updated, Logged };
 
     CANMessage() { status = None; }
-    CANMessage(const QString &can, quint32 id, const QByteArray &data);
+    CANMessage(const QString &can, const CANFrame &frame);
 
     void setLength(quint8 len);
+    Result update(const CANFrame &frame, bool logChange, bool genMask);
+    void clearLog();
 
     QString can;
+    quint16 bus = BusTable::NoBus;
     quint32 id = 0;
     Status status;
     quint64 data = 0;
@@ -39,7 +54,11 @@ public:
     quint64 mask = 0;
     quint64 bitmask = 0;
     quint64 chbits = 0;
+    quint64 known = 0;      // counter and checksum bits, never logged as changes
+    SignalDetector detector;
     QLinkedList<MessageLog> changeLog;
+    ChangeIndex changes;    // masked deltas of changeLog by time
+    quint32 logEpoch = 0;   // bumped whenever changeLog is cleared
     QString note;
 };
 
@@ -61,6 +80,20 @@ public:
     bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
 
     void loadLog(QString fname);
+    void loadLogs(const QStringList &fnames);
+    void loadFrames(FrameReader *reader, SidecarIndex *index = nullptr);
+
+    // single logs are indexed in "<log>.cidx" and reopened from it
+    void setUseIndex(bool val) { _useIndex = val; }
+    bool useIndex() { return _useIndex; }
+    // log bytes between index checkpoints
+    void setIndexInterval(qint64 bytes) { _indexInterval = bytes; }
+    // modes and masks an index must have been written with to be used
+    SidecarIndex::Settings indexSettings() const;
+    bool canSeek() const { return !_indexedLog.isEmpty(); }
+    quint64 indexedFirst() const { return _indexedFirst; }
+    quint64 indexedLast() const { return _indexedLast; }
+    bool seekTo(quint64 ts);
     void clearAll();
     void clearStatus();
     void clearMasks();
@@ -72,7 +105,38 @@ public:
     bool genMask() { return _genMask; }
     void setFiltering(bool val) { _filtering = val; }
     bool filtering() { return _filtering; }
-    void procMessage(quint64 sec, quint32 usec, const QString &can, quint32 id, const QByteArray &data, bool update = true);
+    // shards of the frame processing, 1 keeps it all on the calling thread
+    void setThreads(int count);
+    int threads() const { return _shards.size(); }
+    void procFrames(const CANFrame *frames, size_t count, bool update = true);
+
+    // state exchange with a capture server
+    const CANMessage &message(int row) const { return _msgs[row]; }
+    RemoteRow exportRow(int row, quint32 changeBase) const;
+    // detectors for update.rows come with index checkpoints
+    void applyRemote(const RemoteUpdate &update, const QVector<SignalDetector> *detectors = nullptr);
+    // bumped when rows are added, removed or renamed by hand, or all cleared
+    quint32 generation() const { return _generation; }
+    // attached GUIs mirror the server, edits would be overwritten
+    void setReadOnly(bool val) { _readOnly = val; }
+    bool readOnly() const { return _readOnly; }
+
+    void setJournal(Journal *journal) { _journal = journal; }
+    BusTable *buses() { return &_buses; }
+    PipelineStats *stats() { return &_stats; }
+    quint64 memoryUsage() const;
+
+    // markers are microsecond timestamps on the frame clock
+    void addMarker() { if(_lastTimestamp) _markers.append(_lastTimestamp); }
+    const QVector<quint64> &markers() const { return _markers; }
+    void clearMarkers() { _markers.clear(); }
+    QVector<CorrelationCandidate> correlate(quint64 before, quint64 after) const;
+
+    // CHBITS shows the bits changed in [from, to) instead of all changes
+    void setTimeWindow(quint64 from, quint64 to);
+    void clearTimeWindow();
+    quint64 firstTimestamp() const { return _firstTimestamp; }
+    quint64 lastTimestamp() const { return _lastTimestamp; }
 
 signals:
     void progressValue(int);
@@ -81,13 +145,54 @@ public slots:
     void onDoubleClicked(const QModelIndex &index);
 
 protected:
+    // rows are sharded by ID so rows bound to any bus stay in one shard
+    struct Shard
+    {
+        QHash<quint64, int> index;      // negative values are pending rows
+        QVector<quint32> frames;        // batch positions of this shard's frames
+        QVector<CANMessage> pending;    // IDs first seen in this batch
+        QVector<quint32> pendingSeq;
+        int first = 0;
+        int last = -1;
+        quint64 logged = 0;
+        quint64 filtered = 0;
+    };
+
     void applyMask(int ix, bool update = true);
+    bool openIndex(SidecarIndex &index, const QString &fname) const;
+    bool reopenIndexed(const QString &fname);
+    bool relogIndexed(int row);
+    bool restoreCheckpoint(SidecarIndex &index, int ix, qint64 &logOffset);
+    void procShard(Shard &shard, const CANFrame *frames, CANMessage *rows) const;
+    void mergeShards(bool update);
+    void rebuildIndex();
+    quint64 changingBits(const CANMessage &msg) const;
+    int shardOf(quint32 id) const { return (quint32(id * 2654435761u) >> 16) % _shards.size(); }
+    static quint64 indexKey(quint16 bus, quint32 id) { return (quint64(bus) << 32) | id; }
 
 protected:
     bool _logChange = false;
     bool _genMask = false;
     bool _filtering = false;
     QVector<CANMessage> _msgs;
+    QVector<Shard> _shards;
+    BusTable _buses;
+    PipelineStats _stats;
+    Journal *_journal = nullptr;
+    quint32 _generation = 0;
+    quint32 _remoteGeneration = 0;
+    bool _readOnly = false;
+    QVector<quint64> _markers;
+    quint64 _firstTimestamp = 0;
+    quint64 _lastTimestamp = 0;
+    bool _useIndex = false;
+    qint64 _indexInterval = SidecarIndex::defaultInterval;
+    QString _indexedLog;
+    quint64 _indexedFirst = 0;
+    quint64 _indexedLast = 0;
+    bool _windowed = false;
+    quint64 _windowFrom = 0;
+    quint64 _windowTo = 0;
 };
 
 QString toHex(quint64 value, quint8 length);
@@ -1,11 +1,97 @@
 #include "mainwindow.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include "canbussource.h"
+#include "captureserver.h"
+#include "logmodel.h"
+#include "tracer.h"
+#ifdef Q_OS_LINUX
+#include "socketcansource.h"
+#endif
+
+// headless capture, GUIs attach with File/Attach to server
+static int runServer(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("CANalizer capture server");
+    parser.addHelpOption();
+    QCommandLineOption serverOption("server", "Serve on a local socket name or host:port, TCP without a host is localhost only.", "address");
+    QCommandLineOption pluginOption("plugin", "QCanBus plugin.", "plugin", "virtualcan");
+    QCommandLineOption interfaceOption("interface", "CAN interface.", "interface", "can0");
+    QCommandLineOption intervalOption("interval", "Update interval in ms.", "ms", "100");
+    QCommandLineOption changesOption("changes", "Log changes from the start.");
+    QCommandLineOption remoteControlOption("remote-control", "Accept commands from TCP clients on other hosts.");
+    parser.addOption(serverOption);
+    parser.addOption(pluginOption);
+    parser.addOption(interfaceOption);
+    parser.addOption(intervalOption);
+    parser.addOption(changesOption);
+    parser.addOption(remoteControlOption);
+    parser.process(a);
+
+    LogModel model(nullptr);
+    model.setLogChange(parser.isSet(changesOption));
+
+    CaptureServer server(&model);
+    server.setInterval(qMax(10, parser.value(intervalOption).toInt()));
+    server.setRemoteControl(parser.isSet(remoteControlOption));
+    if(!server.listen(parser.value(serverOption)))
+    {
+        qCritical("Cannot listen on %s: %s", qPrintable(parser.value(serverOption)), qPrintable(server.errorString()));
+        return 1;
+    }
+
+    QString plugin = parser.value(pluginOption);
+    QString interface = parser.value(interfaceOption);
+#ifdef Q_OS_LINUX
+    if(plugin == SocketCanSource::pluginName())
+    {
+        SocketCanSource source(&model);
+        if(!source.open(interface))
+        {
+            qCritical("Cannot open %s: %s", qPrintable(interface), qPrintable(source.errorString()));
+            return 1;
+        }
+        return a.exec();
+    }
+#endif
+    CanBusSource source(&model);
+    if(!source.open(plugin, interface))
+    {
+        qCritical("Cannot open %s: %s", qPrintable(interface), qPrintable(source.errorString()));
+        return 1;
+    }
+    return a.exec();
+}
 
 int main(int argc, char *argv[])
 {
+    // CANALIZER_TRACE=file.json traces the whole session
+    QString traceFile = QString::fromLocal8Bit(qgetenv("CANALIZER_TRACE"));
+
+    for(int i = 1; i < argc; i++)
+    {
+        if((qstrcmp(argv[i], "--server") == 0) || (qstrncmp(argv[i], "--server=", 9) == 0))
+        {
+            if(!traceFile.isEmpty()) Tracer::instance()->start(traceFile);
+            int res = runServer(argc, argv);
+            Tracer::instance()->stop();
+            return res;
+        }
+    }
+
     QApplication a(argc, argv);
+
+    if(!traceFile.isEmpty()) Tracer::instance()->start(traceFile);
+
     MainWindow w;
     w.show();
 
-    return a.exec();
+    int res = a.exec();
+    if(Tracer::instance()->running() && !Tracer::instance()->stop())
+        qWarning("Trace not written: %s", qPrintable(Tracer::instance()->errorString()));
+    return res;
 }
@@ -2,11 +2,16 @@
 #include "ui_mainwindow.h"
 #include <QFileDialog>
 #include <QSettings>
-#include <QCanBus>
-#include <QCanBusFrame>
 #include "capturedialog.h"
+#include "correlationdialog.h"
 #include <QShortcut>
 #include <QDebug>
+#include <QDir>
+#include <QInputDialog>
+#include <QStandardPaths>
+#include "tracer.h"
+
+const QString USE_INDEX_KEY("use_index");
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -18,6 +23,8 @@ MainWindow::MainWindow(QWidget *parent) :
     proxymodel = new QSortFilterProxyModel(this);
     proxymodel->setSourceModel(model);
     ui->tableView->setModel(proxymodel);
+    connect(proxymodel, &QSortFilterProxyModel::layoutAboutToBeChanged, []() { Tracer::instance()->begin("proxy:layout"); });
+    connect(proxymodel, &QSortFilterProxyModel::layoutChanged, []() { Tracer::instance()->end("proxy:layout"); });
     ui->tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
     ui->tableView->sortByColumn(1, Qt::AscendingOrder);
 
@@ -30,6 +37,44 @@ MainWindow::MainWindow(QWidget *parent) :
     progressBar->setMinimum(0);
     progressBar->setMaximum(100);
 
+    QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dataDir);
+    journal = new Journal(this);
+    if(journal->open(dataDir + "/journal.dat"))
+        model->setJournal(journal);
+    else
+        qWarning() << "Journal disabled:" << journal->errorString();
+    connect(journal, &Journal::errorOccurred, [this](const QString &error)
+    {
+        statusBar()->showMessage(tr("Notes and masks not saved: %1").arg(error));
+    });
+
+    statsLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(statsLabel, 0);
+    statsTimer = new QTimer(this);
+    connect(statsTimer, &QTimer::timeout, this, &MainWindow::updateStats);
+    statsTimer->start(1000);
+
+    // window sliders are in per mille of the captured time range
+    windowBar = new QToolBar(tr("Time window"), this);
+    windowFrom = new QSlider(Qt::Horizontal, windowBar);
+    windowFrom->setRange(0, 1000);
+    windowTo = new QSlider(Qt::Horizontal, windowBar);
+    windowTo->setRange(0, 1000);
+    windowTo->setValue(1000);
+    windowLabel = new QLabel(windowBar);
+    windowBar->addWidget(windowFrom);
+    windowBar->addWidget(windowTo);
+    windowBar->addWidget(windowLabel);
+    addToolBarBreak();
+    addToolBar(windowBar);
+    windowBar->hide();
+    connect(windowFrom, &QSlider::valueChanged, this, &MainWindow::timeWindowChanged);
+    connect(windowTo, &QSlider::valueChanged, this, &MainWindow::timeWindowChanged);
+
+    ui->actionTrace->setChecked(Tracer::instance()->running());
+    ui->actionUseIndex->setChecked(QSettings().value(USE_INDEX_KEY, false).toBool());
+
     QShortcut* del = new QShortcut(QKeySequence(Qt::Key_Delete), ui->tableView);
     connect(del, SIGNAL(activated()), this, SLOT(on_actionRemoveIDs_triggered()));
     QShortcut* ins = new QShortcut(QKeySequence(Qt::Key_Insert), ui->tableView);
@@ -44,6 +89,7 @@ MainWindow::~MainWindow()
 void MainWindow::on_actionClearAll_triggered()
 {
     model->clearAll();
+    ui->actionSeek->setEnabled(false);
 }
 
 void MainWindow::on_actionLoad_triggered()
@@ -52,20 +98,21 @@ void MainWindow::on_actionLoad_triggered()
 
     QSettings settings;
 
-    QString selectedFile = QFileDialog::getOpenFileName(
-            this, QString("Select a logfile"),
+    QStringList selectedFiles = QFileDialog::getOpenFileNames(
+            this, QString("Select logfiles"),
                 settings.value(DEFAULT_DIR_KEY).toString());
 
-    if(!selectedFile.isEmpty())
+    if(!selectedFiles.isEmpty())
     {
         settings.setValue(DEFAULT_DIR_KEY,
-                            QFileInfo(selectedFile).absolutePath());
+                            QFileInfo(selectedFiles.first()).absolutePath());
 
         statusBar()->addPermanentWidget(progressBar, 0);
         statusBar()->showMessage(QString("Loading"));
         connect(model, &LogModel::progressValue, progressBar, &QProgressBar::setValue);
 
-        model->loadLog(selectedFile);
+        model->loadLogs(selectedFiles);
+        ui->actionSeek->setEnabled(model->canSeek());
 
         disconnect(progressBar);
         statusBar()->clearMessage();
@@ -77,6 +124,7 @@ void MainWindow::on_actionChanges_toggled(bool arg1)
 {
     if(arg1) ui->actionGenMask->setChecked(false);
     model->setLogChange(arg1);
+    if(remote) remote->sendCommand(RemoteProtocol::SetLogChange, arg1);
 }
 
 void MainWindow::on_actionExit_triggered()
@@ -96,31 +144,48 @@ void MainWindow::on_actionStartCapture_triggered()
     {
         settings.setValue(DEFAULT_CANPLUGIN_KEY, dlg.plugin());
         settings.setValue(DEFAULT_CANIF_KEY, dlg.interface());
-        canInterface = dlg.interface();
 
-        QString errorString;
-        canDevice = QCanBus::instance()->createDevice(dlg.plugin(), dlg.interface(), &errorString);
-        if(!canDevice)
+#ifdef Q_OS_LINUX
+        if(dlg.plugin() == SocketCanSource::pluginName())
         {
-            statusBar()->showMessage(tr("Error creating device '%1': '%2'")
-                              .arg(dlg.plugin()).arg(errorString));
-            canInterface.clear();
+            canSource = new SocketCanSource(model, this);
+            if(!canSource->open(dlg.interface()))
+            {
+                statusBar()->showMessage(tr("Connection error: %1").arg(canSource->errorString()));
+                delete canSource;
+                canSource = nullptr;
+                return;
+            }
+            connect(canSource, &SocketCanSource::errorOccurred, [](const QString &error) { qWarning() << error; });
+
+            ui->actionLoad->setEnabled(false);
+            ui->actionSeek->setEnabled(false);
+            ui->actionStartCapture->setEnabled(false);
+            ui->actionStopCapture->setEnabled(true);
+            ui->actionFollow->setEnabled(false);
+            ui->actionAttach->setEnabled(false);
+
+            statusBar()->showMessage(tr("Connected to %1").arg(dlg.interface()));
             return;
         }
+#endif
 
-        connect(canDevice, &QCanBusDevice::errorOccurred, this, &MainWindow::errorOccurred);
-        connect(canDevice, &QCanBusDevice::framesReceived, this, &MainWindow::framesReceived);
-
-        if(!canDevice->connectDevice()) {
+        canDevice = new CanBusSource(model, this);
+        if(!canDevice->open(dlg.plugin(), dlg.interface()))
+        {
             statusBar()->showMessage(tr("Connection error: %1").arg(canDevice->errorString()));
             delete canDevice;
             canDevice = nullptr;
-            canInterface.clear();
             return;
         }
+        connect(canDevice, &CanBusSource::errorOccurred, [](const QString &error) { qWarning() << error; });
+
         ui->actionLoad->setEnabled(false);
+        ui->actionSeek->setEnabled(false);
         ui->actionStartCapture->setEnabled(false);
         ui->actionStopCapture->setEnabled(true);
+        ui->actionFollow->setEnabled(false);
+        ui->actionAttach->setEnabled(false);
 
         statusBar()->showMessage(tr("Connected to %1").arg(dlg.interface()));
     }
@@ -128,70 +193,60 @@ void MainWindow::on_actionStartCapture_triggered()
 
 void MainWindow::on_actionStopCapture_triggered()
 {
-    if(!canDevice) return;
+#ifdef Q_OS_LINUX
+    if(canSource)
+    {
+        delete canSource;
+        canSource = nullptr;
+    }
+    else
+#endif
+    {
+        if(!canDevice) return;
 
-    canDevice->disconnectDevice();
-    delete canDevice;
-    canDevice = nullptr;
+        delete canDevice;
+        canDevice = nullptr;
+    }
 
     ui->actionLoad->setEnabled(true);
+    ui->actionSeek->setEnabled(model->canSeek());
     ui->actionStartCapture->setEnabled(true);
     ui->actionStopCapture->setEnabled(false);
+    ui->actionFollow->setEnabled(true);
+    ui->actionAttach->setEnabled(true);
 
     statusBar()->showMessage(tr("Disconnected"));
 }
 
-void MainWindow::errorOccurred(QCanBusDevice::CanBusError error) const
-{
-    switch (error) {
-    case QCanBusDevice::ReadError:
-    case QCanBusDevice::WriteError:
-    case QCanBusDevice::ConnectionError:
-    case QCanBusDevice::ConfigurationError:
-    case QCanBusDevice::UnknownError:
-        qWarning() << canDevice->errorString();
-    default:
-        break;
-    }
-}
-
-void MainWindow::framesReceived()
-{
-    if(!canDevice) return;
-
-    while(canDevice->framesAvailable())
-    {
-        const QCanBusFrame frame = canDevice->readFrame();
-        model->procMessage(frame.timeStamp().seconds(), frame.timeStamp().microSeconds(),
-                    canInterface, frame.frameId(),
-                    frame.payload());
-    }
-}
-
 void MainWindow::on_actionGenMask_toggled(bool arg1)
 {
     if(arg1) ui->actionChanges->setChecked(false);
     model->setGenMask(arg1);
+    if(remote) remote->sendCommand(RemoteProtocol::SetGenMask, arg1);
 }
 
 void MainWindow::on_actionClearStatus_triggered()
 {
     model->clearStatus();
+    if(remote) remote->sendCommand(RemoteProtocol::ClearStatus);
 }
 
 void MainWindow::on_actionClearMasks_triggered()
 {
     model->clearMasks();
+    if(remote) remote->sendCommand(RemoteProtocol::ClearMasks);
 }
 
 void MainWindow::on_actionClearChanges_triggered()
 {
     model->clearChanges();
+    if(remote) remote->sendCommand(RemoteProtocol::ClearChanges);
 }
 
 void MainWindow::on_actionFiltering_toggled(bool arg1)
 {
     model->setFiltering(arg1);
+    if(remote) remote->sendCommand(RemoteProtocol::SetFiltering, arg1);
 }
 
 void MainWindow::on_actionAddID_triggered()
@@ -214,3 +269,248 @@ void MainWindow::onDoubleClicked(const QModelIndex &index)
 {
     model->onDoubleClicked(proxymodel->mapToSource(index));
 }
+
+void MainWindow::on_actionDumpStats_triggered()
+{
+    const QString DEFAULT_DIR_KEY("default_dir");
+
+    QSettings settings;
+
+    QString selectedFile = QFileDialog::getSaveFileName(
+            this, QString("Select a statistics file"),
+                settings.value(DEFAULT_DIR_KEY).toString() + QString("/canalizer-stats.txt"),
+                "Text files (*.txt)");
+
+    if(!selectedFile.isEmpty())
+    {
+        if(!model->stats()->dump(selectedFile))
+            statusBar()->showMessage(tr("Cannot write '%1'").arg(selectedFile));
+    }
+}
+
+void MainWindow::on_actionFollow_toggled(bool arg1)
+{
+    if(!arg1)
+    {
+        delete follower;
+        follower = nullptr;
+        ui->actionLoad->setEnabled(true);
+        ui->actionSeek->setEnabled(model->canSeek());
+        ui->actionStartCapture->setEnabled(true);
+        ui->actionAttach->setEnabled(true);
+        statusBar()->clearMessage();
+        return;
+    }
+
+    const QString DEFAULT_DIR_KEY("default_dir");
+
+    QSettings settings;
+
+    QString selectedFile = QFileDialog::getOpenFileName(
+            this, QString("Select a logfile to follow"),
+                settings.value(DEFAULT_DIR_KEY).toString());
+
+    if(selectedFile.isEmpty())
+    {
+        ui->actionFollow->setChecked(false);
+        return;
+    }
+    settings.setValue(DEFAULT_DIR_KEY,
+                        QFileInfo(selectedFile).absolutePath());
+
+    follower = new LogFollower(model, this);
+    connect(follower, &LogFollower::restarted, [this]() { statusBar()->showMessage(tr("Followed log was truncated, reading from start")); });
+
+    statusBar()->addPermanentWidget(progressBar, 0);
+    connect(model, &LogModel::progressValue, progressBar, &QProgressBar::setValue);
+    bool ok = follower->start(selectedFile);
+    disconnect(progressBar);
+    statusBar()->removeWidget(progressBar);
+
+    if(!ok)
+    {
+        statusBar()->showMessage(tr("Cannot follow '%1': %2").arg(selectedFile).arg(follower->errorString()));
+        delete follower;
+        follower = nullptr;
+        ui->actionFollow->setChecked(false);
+        return;
+    }
+    ui->actionLoad->setEnabled(false);
+    ui->actionSeek->setEnabled(false);
+    ui->actionStartCapture->setEnabled(false);
+    ui->actionAttach->setEnabled(false);
+    statusBar()->showMessage(tr("Following %1").arg(selectedFile));
+}
+
+void MainWindow::on_actionTrace_toggled(bool arg1)
+{
+    Tracer *tracer = Tracer::instance();
+    if(arg1 == tracer->running()) return;
+
+    if(!arg1)
+    {
+        if(tracer->stop())
+            statusBar()->showMessage(tr("Trace written"));
+        else
+            statusBar()->showMessage(tr("Trace not written: %1").arg(tracer->errorString()));
+        return;
+    }
+
+    const QString DEFAULT_DIR_KEY("default_dir");
+
+    QSettings settings;
+
+    QString selectedFile = QFileDialog::getSaveFileName(
+            this, QString("Select a trace file"),
+                settings.value(DEFAULT_DIR_KEY).toString() + QString("/canalizer-trace.json"),
+                "Trace files (*.json)");
+
+    if(selectedFile.isEmpty() || !tracer->start(selectedFile))
+    {
+        ui->actionTrace->setChecked(false);
+        return;
+    }
+    statusBar()->showMessage(tr("Tracing to %1").arg(selectedFile));
+}
+
+void MainWindow::on_actionAddMarker_triggered()
+{
+    model->addMarker();
+    statusBar()->showMessage(tr("%1 markers").arg(model->markers().size()));
+}
+
+void MainWindow::on_actionCorrelate_triggered()
+{
+    if(model->markers().isEmpty())
+    {
+        statusBar()->showMessage(tr("No markers, add some during capture"));
+        return;
+    }
+
+    CorrelationDialog dlg(this, model);
+    dlg.exec();
+}
+
+void MainWindow::on_actionUseIndex_toggled(bool arg1)
+{
+    model->setUseIndex(arg1);
+    QSettings().setValue(USE_INDEX_KEY, arg1);
+}
+
+void MainWindow::on_actionSeek_triggered()
+{
+    quint64 first = model->indexedFirst();
+    double span = (model->indexedLast() - first) / 1e6;
+    bool ok;
+    double sec = QInputDialog::getDouble(this, tr("Seek to time"), tr("Seconds from the start of the log"),
+                                         0.0, 0.0, span, 3, &ok);
+    if(!ok) return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool res = model->seekTo(first + quint64(sec * 1e6));
+    QApplication::restoreOverrideCursor();
+    statusBar()->showMessage(res ? tr("At %1 s").arg(sec, 0, 'f', 3) : tr("Seek failed, reload the log"));
+}
+
+void MainWindow::on_actionClearMarkers_triggered()
+{
+    model->clearMarkers();
+    statusBar()->showMessage(tr("Markers cleared"));
+}
+
+void MainWindow::on_actionTimeWindow_toggled(bool arg1)
+{
+    windowBar->setVisible(arg1);
+    if(arg1) timeWindowChanged();
+    else model->clearTimeWindow();
+}
+
+void MainWindow::timeWindowChanged()
+{
+    if(!ui->actionTimeWindow->isChecked()) return;
+
+    TRACE_SCOPE("timeWindowChanged");
+    quint64 first = model->firstTimestamp();
+    quint64 span = model->lastTimestamp() - first + 1;
+    int from = qMin(windowFrom->value(), windowTo->value());
+    int to = qMax(windowFrom->value(), windowTo->value());
+    quint64 t0 = first + span * from / 1000;
+    quint64 t1 = first + span * to / 1000;
+    model->setTimeWindow(t0, t1);
+    windowLabel->setText(QString("%1.%2 - %3.%4")
+                         .arg(t0 / 1000000).arg(t0 % 1000000, 6, 10, QChar('0'))
+                         .arg(t1 / 1000000).arg(t1 % 1000000, 6, 10, QChar('0')));
+}
+
+void MainWindow::on_actionAttach_toggled(bool arg1)
+{
+    if(!arg1)
+    {
+        if(!remote) return;
+        remote->deleteLater();
+        remote = nullptr;
+        model->setReadOnly(false);
+        ui->actionAddID->setEnabled(true);
+        ui->actionRemoveIDs->setEnabled(true);
+        ui->actionLoad->setEnabled(true);
+        ui->actionSeek->setEnabled(model->canSeek());
+        ui->actionFollow->setEnabled(true);
+        ui->actionStartCapture->setEnabled(true);
+        statusBar()->showMessage(tr("Detached"));
+        return;
+    }
+
+    const QString DEFAULT_SERVER_KEY("server_address");
+
+    QSettings settings;
+    bool ok;
+    QString address = QInputDialog::getText(this, tr("Attach to server"), tr("Local socket name or host:port"),
+                                            QLineEdit::Normal, settings.value(DEFAULT_SERVER_KEY, "canalizer").toString(), &ok);
+    if(!ok || address.isEmpty())
+    {
+        ui->actionAttach->setChecked(false);
+        return;
+    }
+    settings.setValue(DEFAULT_SERVER_KEY, address);
+
+    remote = new RemoteClient(model, this);
+    if(!remote->connectTo(address))
+    {
+        statusBar()->showMessage(tr("Cannot attach to '%1': %2").arg(address).arg(remote->errorString()));
+        delete remote;
+        remote = nullptr;
+        ui->actionAttach->setChecked(false);
+        return;
+    }
+    connect(remote, &RemoteClient::disconnected, [this]() { ui->actionAttach->setChecked(false); });
+
+    // the server owns the state from here on, local edits would be overwritten
+    if(model->rowCount() > 0) model->clearAll();
+    model->setReadOnly(true);
+    ui->actionAddID->setEnabled(false);
+    ui->actionRemoveIDs->setEnabled(false);
+    remote->sendCommand(RemoteProtocol::SetLogChange, ui->actionChanges->isChecked());
+    remote->sendCommand(RemoteProtocol::SetGenMask, ui->actionGenMask->isChecked());
+    remote->sendCommand(RemoteProtocol::SetFiltering, ui->actionFiltering->isChecked());
+
+    ui->actionLoad->setEnabled(false);
+    ui->actionSeek->setEnabled(false);
+    ui->actionFollow->setEnabled(false);
+    ui->actionStartCapture->setEnabled(false);
+    statusBar()->showMessage(tr("Attached to %1").arg(address));
+}
+
+void MainWindow::updateStats()
+{
+    if(remote)
+    {
+        statsLabel->setText(remote->stats());
+        return;
+    }
+
+    PipelineStats *stats = model->stats();
+    stats->set(PipelineStats::PendingFrames, canDevice ? canDevice->pending() : 0);
+    stats->set(PipelineStats::MemoryBytes, model->memoryUsage());
+    stats->sample();
+    statsLabel->setText(stats->summary());
+}
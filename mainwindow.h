@@ -3,9 +3,19 @@
 
 #include <QMainWindow>
 #include <QProgressBar>
+#include <QLabel>
+#include <QSlider>
+#include <QToolBar>
+#include <QTimer>
 #include "logmodel.h"
-#include <QCanBusDevice>
+#include "logfollower.h"
+#include "journal.h"
+#include "canbussource.h"
+#include "remoteclient.h"
 #include <QSortFilterProxyModel>
+#ifdef Q_OS_LINUX
+#include "socketcansource.h"
+#endif
 
 namespace Ui {
 class MainWindow;
@@ -26,8 +36,6 @@ private slots:
     void on_actionExit_triggered();
     void on_actionStartCapture_triggered();
     void on_actionStopCapture_triggered();
-    void errorOccurred(QCanBusDevice::CanBusError) const;
-    void framesReceived();
     void on_actionGenMask_toggled(bool arg1);
     void on_actionClearStatus_triggered();
     void on_actionClearMasks_triggered();
@@ -36,14 +44,37 @@ private slots:
     void on_actionAddID_triggered();
     void on_actionRemoveIDs_triggered();
     void onDoubleClicked(const QModelIndex &index);
+    void on_actionDumpStats_triggered();
+    void on_actionTrace_toggled(bool arg1);
+    void on_actionFollow_toggled(bool arg1);
+    void on_actionAddMarker_triggered();
+    void on_actionCorrelate_triggered();
+    void on_actionClearMarkers_triggered();
+    void on_actionTimeWindow_toggled(bool arg1);
+    void on_actionAttach_toggled(bool arg1);
+    void on_actionUseIndex_toggled(bool arg1);
+    void on_actionSeek_triggered();
+    void timeWindowChanged();
+    void updateStats();
 
 private:
     Ui::MainWindow *ui;
     LogModel *model = nullptr;
     QSortFilterProxyModel *proxymodel = nullptr;
     QProgressBar *progressBar = nullptr;
-    QCanBusDevice *canDevice = nullptr;
-    QString canInterface;
+    QLabel *statsLabel = nullptr;
+    QTimer *statsTimer = nullptr;
+    QToolBar *windowBar = nullptr;
+    QSlider *windowFrom = nullptr;
+    QSlider *windowTo = nullptr;
+    QLabel *windowLabel = nullptr;
+    LogFollower *follower = nullptr;
+    Journal *journal = nullptr;
+    RemoteClient *remote = nullptr;
+    CanBusSource *canDevice = nullptr;
+#ifdef Q_OS_LINUX
+    SocketCanSource *canSource = nullptr;
+#endif
 };
 
 #endif // MAINWINDOW_H
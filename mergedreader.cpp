@@ -0,0 +1,180 @@
+#include "mergedreader.h"
+#include <QFileInfo>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QWaitCondition>
+#include <algorithm>
+#include <atomic>
+
+const int chunkFrames = 4096;
+// read-ahead per log, in chunks
+const int queueChunks = 4;
+
+// Runs one reader and hands its frames over in chunks through a bounded queue.
+class MergeFeeder : public QThread
+{
+public:
+    MergeFeeder(FrameReader *reader) : _reader(reader) {}
+
+    ~MergeFeeder()
+    {
+        {
+            QMutexLocker lock(&_mutex);
+            _abort = true;
+            _notFull.wakeAll();
+        }
+        wait();
+        delete _reader;
+    }
+
+    // blocks until a chunk is ready, an empty chunk marks the end
+    QVector<CANFrame> take()
+    {
+        QMutexLocker lock(&_mutex);
+        while(_queue.isEmpty() && !_done) _notEmpty.wait(&_mutex);
+        if(_queue.isEmpty()) return QVector<CANFrame>();
+        QVector<CANFrame> res = _queue.dequeue();
+        _notFull.wakeOne();
+        return res;
+    }
+
+    qint64 pos() const { return _pos.load(std::memory_order_relaxed); }
+    FrameReader *reader() const { return _reader; }
+
+protected:
+    void run() override
+    {
+        for(;;)
+        {
+            QVector<CANFrame> chunk(chunkFrames);
+            int count = _reader->read(chunk.data(), chunkFrames);
+            _pos.store(_reader->pos(), std::memory_order_relaxed);
+            if(count <= 0) break;
+            chunk.resize(count);
+
+            QMutexLocker lock(&_mutex);
+            while((_queue.size() >= queueChunks) && !_abort) _notFull.wait(&_mutex);
+            if(_abort) return;
+            _queue.enqueue(chunk);
+            _notEmpty.wakeOne();
+        }
+        QMutexLocker lock(&_mutex);
+        _done = true;
+        _notEmpty.wakeAll();
+    }
+
+private:
+    FrameReader *_reader;
+    QMutex _mutex;
+    QWaitCondition _notEmpty;
+    QWaitCondition _notFull;
+    QQueue<QVector<CANFrame>> _queue;
+    bool _done = false;
+    bool _abort = false;
+    std::atomic<qint64> _pos { 0 };
+};
+
+MergedReader::MergedReader(BusTable *buses)
+    :FrameReader(buses)
+{
+}
+
+MergedReader::~MergedReader()
+{
+    close();
+}
+
+void MergedReader::close()
+{
+    for(Stream &stream : _streams) delete stream.feeder;
+    _streams.clear();
+    _heap.clear();
+    _size = 0;
+}
+
+bool MergedReader::open(const QString &fname)
+{
+    return open(QStringList(fname));
+}
+
+bool MergedReader::open(const QStringList &fnames)
+{
+    close();
+    for(const QString &fname : fnames)
+    {
+        FrameReader *reader = FrameReader::create(fname, _buses);
+        if(!reader->open(fname))
+        {
+            _errorString = QString("%1: %2").arg(QFileInfo(fname).fileName()).arg(reader->errorString());
+            delete reader;
+            close();
+            return false;
+        }
+        _size += reader->size();
+        _streams.append({ new MergeFeeder(reader), QVector<CANFrame>(), 0 });
+    }
+
+    for(Stream &stream : _streams) stream.feeder->start();
+    for(int i = 0; i < _streams.size(); i++)
+    {
+        if(advance(i)) _heap.append(i);
+    }
+    std::make_heap(_heap.begin(), _heap.end(), [this](int a, int b) { return later(a, b); });
+    return true;
+}
+
+// heap order, equal timestamps keep the order of the files as given
+bool MergedReader::later(int a, int b) const
+{
+    quint64 ta = _streams[a].chunk[_streams[a].next].timestamp();
+    quint64 tb = _streams[b].chunk[_streams[b].next].timestamp();
+    return (ta != tb) ? (ta > tb) : (a > b);
+}
+
+// makes the next frame of a stream available, false at its end
+bool MergedReader::advance(int ix)
+{
+    Stream &stream = _streams[ix];
+    if(stream.next < stream.chunk.size()) return true;
+    stream.chunk = stream.feeder->take();
+    stream.next = 0;
+    return !stream.chunk.isEmpty();
+}
+
+int MergedReader::read(CANFrame *frames, int max)
+{
+    auto cmp = [this](int a, int b) { return later(a, b); };
+
+    int count = 0;
+    while((count < max) && !_heap.isEmpty())
+    {
+        std::pop_heap(_heap.begin(), _heap.end(), cmp);
+        int ix = _heap.last();
+        Stream &stream = _streams[ix];
+
+        // copy the run that stays ahead of the next stream at once
+        int top = (_heap.size() > 1) ? _heap.first() : -1;
+        do
+        {
+            frames[count++] = stream.chunk[stream.next++];
+        }
+        while((count < max) && (stream.next < stream.chunk.size()) && ((top < 0) || later(top, ix)));
+
+        if(advance(ix)) std::push_heap(_heap.begin(), _heap.end(), cmp);
+        else _heap.removeLast();
+    }
+    return count;
+}
+
+qint64 MergedReader::pos() const
+{
+    qint64 res = 0;
+    for(const Stream &stream : _streams) res += stream.feeder->pos();
+    return res;
+}
+
+qint64 MergedReader::size() const
+{
+    return _size;
+}
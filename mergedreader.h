@@ -0,0 +1,41 @@
+#ifndef MERGEDREADER_H
+#define MERGEDREADER_H
+
+#include <QStringList>
+#include <QVector>
+#include "framereader.h"
+
+class MergeFeeder;
+
+// Reads several logs at once, each on its own thread, and merges them into
+// one stream ordered by timestamp. Every log must be in time order itself.
+class MergedReader : public FrameReader
+{
+public:
+    explicit MergedReader(BusTable *buses);
+    ~MergedReader();
+
+    bool open(const QString &fname) override;
+    bool open(const QStringList &fnames);
+    int read(CANFrame *frames, int max) override;
+    qint64 pos() const override;
+    qint64 size() const override;
+
+protected:
+    struct Stream
+    {
+        MergeFeeder *feeder;
+        QVector<CANFrame> chunk;
+        int next;
+    };
+
+    bool advance(int ix);
+    bool later(int a, int b) const;
+    void close();
+
+    QVector<Stream> _streams;
+    QVector<int> _heap;     // stream indexes, earliest frame on top
+    qint64 _size = 0;
+};
+
+#endif // MERGEDREADER_H
@@ -0,0 +1,274 @@
+#include "pcapreader.h"
+#include <QtEndian>
+#include <cstring>
+#include "tracer.h"
+
+const quint32 pcapMagic = 0xa1b2c3d4;
+const quint32 pcapNanoMagic = 0xa1b23c4d;
+const quint32 pcapngSectionHeader = 0x0a0d0d0a;
+const quint32 pcapngByteOrder = 0x1a2b3c4d;
+
+enum PcapngBlock { InterfaceDescription = 1, ObsoletePacket = 2, SimplePacket = 3, EnhancedPacket = 6 };
+enum PcapngOption { OptEnd = 0, OptIfName = 2, OptIfTsresol = 9 };
+
+const quint16 LINKTYPE_CAN_SOCKETCAN = 227;
+
+// SocketCAN id flags and FD flags as stored in LINKTYPE_CAN_SOCKETCAN headers
+const quint32 canEffFlag = 0x80000000U;
+const quint32 canRtrFlag = 0x40000000U;
+const quint32 canErrFlag = 0x20000000U;
+const quint32 canEffMask = 0x1fffffffU;
+const quint32 canSffMask = 0x000007ffU;
+const quint8 canFdFdf = 0x04;
+const quint8 canXlXlf = 0x80;
+const quint32 canMtu = 16;
+
+PcapReader::PcapReader(BusTable *buses)
+    :FrameReader(buses)
+{
+}
+
+PcapReader::~PcapReader()
+{
+    if(_data) _file.unmap(const_cast<uchar *>(_data));
+}
+
+bool PcapReader::probe(const uchar *magic, int len)
+{
+    if(len < 4) return false;
+    quint32 le = qFromLittleEndian<quint32>(magic);
+    quint32 be = qFromBigEndian<quint32>(magic);
+    return (le == pcapngSectionHeader) || (le == pcapMagic) || (be == pcapMagic)
+            || (le == pcapNanoMagic) || (be == pcapNanoMagic);
+}
+
+quint16 PcapReader::u16(const uchar *p) const
+{
+    return _swapped ? qFromBigEndian<quint16>(p) : qFromLittleEndian<quint16>(p);
+}
+
+quint32 PcapReader::u32(const uchar *p) const
+{
+    return _swapped ? qFromBigEndian<quint32>(p) : qFromLittleEndian<quint32>(p);
+}
+
+bool PcapReader::open(const QString &fname)
+{
+    _file.setFileName(fname);
+    if(!_file.open(QIODevice::ReadOnly))
+    {
+        _errorString = _file.errorString();
+        return false;
+    }
+    _size = _file.size();
+    if(_size < 24)
+    {
+        _errorString = QString("Truncated capture");
+        return false;
+    }
+    _data = _file.map(0, _size);
+    if(!_data)
+    {
+        _errorString = _file.errorString();
+        return false;
+    }
+
+    _pos = 0;
+    _interfaces.clear();
+    quint32 magic = qFromLittleEndian<quint32>(_data);
+    if(magic == pcapngSectionHeader)
+    {
+        // byte order comes with every section header
+        _ng = true;
+        return true;
+    }
+
+    _ng = false;
+    _swapped = (magic != pcapMagic) && (magic != pcapNanoMagic);
+    _nano = (u32(_data) == pcapNanoMagic);
+    // upper half carries FCS information
+    _linkType = u32(_data + 20) & 0xffff;
+    _bus = busHandle("pcap", 4);
+    _pos = 24;
+    return true;
+}
+
+int PcapReader::read(CANFrame *frames, int max)
+{
+    TRACE_SCOPE("parse");
+
+    int count = 0;
+    while((count < max) && (_pos < _size))
+    {
+        bool ok = _ng ? readPcapngBlock(frames[count]) : readPcapRecord(frames[count]);
+        if(ok) count++;
+    }
+    return count;
+}
+
+bool PcapReader::readPcapRecord(CANFrame &frame)
+{
+    const uchar *p = _data + _pos;
+    if((_size - _pos) < 16)
+    {
+        _pos = _size;
+        return false;
+    }
+    quint32 caplen = u32(p + 8);
+    if((_size - _pos - 16) < caplen)
+    {
+        _pos = _size;
+        return false;
+    }
+    _pos += 16 + caplen;
+
+    if(!decode(p + 16, caplen, _linkType, _bus, frame)) return false;
+    frame.sec = u32(p);
+    frame.usec = _nano ? (u32(p + 4) / 1000) : u32(p + 4);
+    return true;
+}
+
+void PcapReader::readSectionHeader()
+{
+    const uchar *p = _data + _pos;
+    _swapped = (qFromLittleEndian<quint32>(p + 8) != pcapngByteOrder);
+    _interfaces.clear();
+}
+
+bool PcapReader::readPcapngBlock(CANFrame &frame)
+{
+    const uchar *p = _data + _pos;
+    if((_size - _pos) < 12)
+    {
+        _pos = _size;
+        return false;
+    }
+    if(qFromLittleEndian<quint32>(p) == pcapngSectionHeader) readSectionHeader();
+
+    quint32 type = u32(p);
+    quint32 len = u32(p + 4);
+    if((len < 12) || ((_size - _pos) < len))
+    {
+        _pos = _size;
+        return false;
+    }
+    _pos += len;
+
+    switch(type)
+    {
+    case InterfaceDescription:
+        if(len >= 20) readInterface(p + 8, len - 12);
+        return false;
+    case EnhancedPacket:
+    case ObsoletePacket:
+    {
+        if(len < 32) return false;
+        quint32 ifid = (type == EnhancedPacket) ? u32(p + 8) : u16(p + 8);
+        quint32 caplen = u32(p + 20);
+        if((ifid >= (quint32)_interfaces.size()) || (caplen > (len - 32))) return false;
+        const Interface &itf = _interfaces[ifid];
+        if(!decode(p + 28, caplen, itf.linkType, itf.bus, frame)) return false;
+        setTime(itf, (quint64(u32(p + 12)) << 32) | u32(p + 16), frame);
+        _lastSec = frame.sec;
+        _lastUsec = frame.usec;
+        return true;
+    }
+    case SimplePacket:
+    {
+        // no timestamp, reuse the previous one
+        if((len < 16) || _interfaces.isEmpty()) return false;
+        quint32 caplen = qMin(u32(p + 8), len - 16);
+        if(!decode(p + 12, caplen, _interfaces[0].linkType, _interfaces[0].bus, frame)) return false;
+        frame.sec = _lastSec;
+        frame.usec = _lastUsec;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+void PcapReader::readInterface(const uchar *body, quint32 len)
+{
+    Interface itf;
+    itf.linkType = u16(body);
+    itf.pow2 = false;
+    itf.resolution = 6;
+    itf.bus = BusTable::NoBus;
+
+    const uchar *opt = body + 8;
+    const uchar *end = body + len;
+    while((opt + 4) <= end)
+    {
+        quint16 code = u16(opt);
+        quint16 olen = u16(opt + 2);
+        if((code == OptEnd) || ((opt + 4 + olen) > end)) break;
+
+        if((code == OptIfName) && (olen > 0))
+        {
+            const char *name = reinterpret_cast<const char *>(opt + 4);
+            int nlen = olen;
+            while((nlen > 0) && (name[nlen - 1] == '\0')) nlen--;
+            if(nlen > 0) itf.bus = busHandle(name, nlen);
+        }
+        else if((code == OptIfTsresol) && (olen >= 1))
+        {
+            itf.pow2 = (opt[4] & 0x80) != 0;
+            itf.resolution = opt[4] & 0x7f;
+        }
+        opt += 4 + ((olen + 3) & ~3);
+    }
+
+    if(itf.bus == BusTable::NoBus)
+    {
+        QByteArray name = QString("pcap%1").arg(_interfaces.size()).toLatin1();
+        itf.bus = busHandle(name.constData(), name.size());
+    }
+    _interfaces.append(itf);
+}
+
+void PcapReader::setTime(const Interface &itf, quint64 ts, CANFrame &frame)
+{
+    if(!itf.pow2 && (itf.resolution == 6))
+    {
+        frame.sec = ts / 1000000;
+        frame.usec = ts % 1000000;
+        return;
+    }
+
+    quint64 units = 1;
+    if(itf.pow2) units <<= qMin<quint8>(itf.resolution, 63);
+    else for(int i = 0; i < qMin<quint8>(itf.resolution, 19); i++) units *= 10;
+
+    frame.sec = ts / units;
+    frame.usec = (quint32)((double)(ts % units) * 1000000.0 / units);
+}
+
+bool PcapReader::decode(const uchar *data, quint32 len, quint16 linkType, quint16 bus, CANFrame &frame)
+{
+    if((linkType != LINKTYPE_CAN_SOCKETCAN) || (len < 8)) return false;
+    // CAN XL records carry CANXL_XLF in the flags byte where the others keep the length
+    if(data[4] & canXlXlf) return false;
+
+    // id and flags are big endian regardless of the file byte order
+    quint32 canId = qFromBigEndian<quint32>(data);
+    frame.bus = bus;
+    frame.flags = 0;
+    if(canId & canEffFlag)
+    {
+        frame.flags |= CANFrame::Extended;
+        frame.id = canId & canEffMask;
+    }
+    else
+    {
+        frame.id = canId & canSffMask;
+    }
+    if(canId & canRtrFlag) frame.flags |= CANFrame::Remote;
+    if(canId & canErrFlag) frame.flags |= CANFrame::Error;
+    if((len > canMtu) || (data[5] & canFdFdf)) frame.flags |= CANFrame::FD;
+
+    quint32 length = qMin<quint32>(data[4], len - 8);
+    frame.length = qMin<quint32>(length, 64);
+    memcpy(frame.data, data + 8, frame.length);
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef PCAPREADER_H
+#define PCAPREADER_H
+
+#include "framereader.h"
+
+// pcap and pcapng reader for LINKTYPE_CAN_SOCKETCAN captures.
+// The file is memory mapped and walked in place.
+class PcapReader : public FrameReader
+{
+public:
+    explicit PcapReader(BusTable *buses);
+    ~PcapReader();
+
+    static bool probe(const uchar *magic, int len);
+
+    bool open(const QString &fname) override;
+    int read(CANFrame *frames, int max) override;
+    qint64 pos() const override { return _pos; }
+    qint64 size() const override { return _size; }
+
+protected:
+    struct Interface
+    {
+        quint16 linkType;
+        quint16 bus;
+        bool pow2;
+        quint8 resolution;
+    };
+
+    quint16 u16(const uchar *p) const;
+    quint32 u32(const uchar *p) const;
+    bool readPcapRecord(CANFrame &frame);
+    bool readPcapngBlock(CANFrame &frame);
+    void readSectionHeader();
+    void readInterface(const uchar *body, quint32 len);
+    bool decode(const uchar *data, quint32 len, quint16 linkType, quint16 bus, CANFrame &frame);
+    void setTime(const Interface &itf, quint64 ts, CANFrame &frame);
+
+    QFile _file;
+    const uchar *_data = nullptr;
+    qint64 _size = 0;
+    qint64 _pos = 0;
+    bool _ng = false;
+    bool _swapped = false;
+    bool _nano = false;
+    quint16 _linkType = 0;
+    quint16 _bus = BusTable::NoBus;
+    quint64 _lastSec = 0;
+    quint32 _lastUsec = 0;
+    QVector<Interface> _interfaces;
+};
+
+#endif // PCAPREADER_H
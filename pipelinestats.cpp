@@ -0,0 +1,107 @@
+#include "pipelinestats.h"
+#include <QDateTime>
+#include <QFile>
+#include <QTextStream>
+
+PipelineStats::PipelineStats()
+{
+    reset();
+}
+
+void PipelineStats::reset()
+{
+    for(int i = 0; i < CounterEnd; i++)
+    {
+        _counters[i].store(0, std::memory_order_relaxed);
+        _last[i] = 0;
+        _rates[i] = 0.0;
+    }
+    for(int i = 0; i < GaugeEnd; i++)
+    {
+        _gauges[i].store(0, std::memory_order_relaxed);
+    }
+    _timer.start();
+}
+
+void PipelineStats::sample()
+{
+    qint64 elapsed = _timer.restart();
+    for(int i = 0; i < CounterEnd; i++)
+    {
+        quint64 value = counter(static_cast<Counter>(i));
+        _rates[i] = (elapsed > 0) ? ((value - _last[i]) * 1000.0 / elapsed) : 0.0;
+        _last[i] = value;
+    }
+}
+
+QString PipelineStats::summary() const
+{
+    return QString("in %1/s  filt %2/s  new %3  chg %4/s  upd %5/s  pend %6  drop %7  mem %8 KiB")
+            .arg(rate(FramesIn), 0, 'f', 0)
+            .arg(rate(FramesFiltered), 0, 'f', 0)
+            .arg(counter(NewIDs))
+            .arg(rate(ChangesLogged), 0, 'f', 0)
+            .arg(rate(DataChanged), 0, 'f', 0)
+            .arg(gauge(PendingFrames))
+            .arg(gauge(KernelDrops))
+            .arg(gauge(MemoryBytes) / 1024);
+}
+
+bool PipelineStats::dump(const QString &fname) const
+{
+    QFile file(fname);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        return false;
+
+    QTextStream out(&file);
+    out << "# " << QDateTime::currentDateTime().toString(Qt::ISODate) << endl;
+    for(int i = 0; i < CounterEnd; i++)
+    {
+        Counter c = static_cast<Counter>(i);
+        out << counterName(c) << "=" << counter(c)
+            << " " << counterName(c) << "_per_sec=" << QString::number(rate(c), 'f', 1) << endl;
+    }
+    for(int i = 0; i < GaugeEnd; i++)
+    {
+        Gauge g = static_cast<Gauge>(i);
+        out << gaugeName(g) << "=" << gauge(g) << endl;
+    }
+    out << endl;
+    out.flush();
+    file.close();
+    return (out.status() == QTextStream::Ok) && (file.error() == QFileDevice::NoError);
+}
+
+QString PipelineStats::counterName(Counter c)
+{
+    switch(c)
+    {
+    case FramesIn:
+        return QString("frames_in");
+    case FramesFiltered:
+        return QString("frames_filtered");
+    case NewIDs:
+        return QString("new_ids");
+    case ChangesLogged:
+        return QString("changes_logged");
+    case DataChanged:
+        return QString("data_changed");
+    default:
+        return QString();
+    }
+}
+
+QString PipelineStats::gaugeName(Gauge g)
+{
+    switch(g)
+    {
+    case PendingFrames:
+        return QString("pending_frames");
+    case MemoryBytes:
+        return QString("memory_bytes");
+    case KernelDrops:
+        return QString("kernel_drops");
+    default:
+        return QString();
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef PIPELINESTATS_H
+#define PIPELINESTATS_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <atomic>
+
+class PipelineStats
+{
+public:
+    enum Counter { FramesIn = 0, FramesFiltered, NewIDs, ChangesLogged, DataChanged, CounterEnd };
+    enum Gauge { PendingFrames = 0, MemoryBytes, KernelDrops, GaugeEnd };
+
+    PipelineStats();
+
+    // hot path, may be called from any thread
+    void add(Counter c, quint64 n = 1) { _counters[c].fetch_add(n, std::memory_order_relaxed); }
+    void set(Gauge g, quint64 v) { _gauges[g].store(v, std::memory_order_relaxed); }
+
+    quint64 counter(Counter c) const { return _counters[c].load(std::memory_order_relaxed); }
+    quint64 gauge(Gauge g) const { return _gauges[g].load(std::memory_order_relaxed); }
+    double rate(Counter c) const { return _rates[c]; }
+
+    void sample();
+    void reset();
+    QString summary() const;
+    bool dump(const QString &fname) const;
+
+    static QString counterName(Counter c);
+    static QString gaugeName(Gauge g);
+
+protected:
+    std::atomic<quint64> _counters[CounterEnd];
+    std::atomic<quint64> _gauges[GaugeEnd];
+    quint64 _last[CounterEnd];
+    double _rates[CounterEnd];
+    QElapsedTimer _timer;
+};
+
+#endif // PIPELINESTATS_H
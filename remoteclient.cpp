@@ -0,0 +1,82 @@
+#include "remoteclient.h"
+#include <QLocalSocket>
+#include <QTcpSocket>
+#include "logmodel.h"
+
+const int connectTimeoutMs = 3000;
+
+RemoteClient::RemoteClient(LogModel *model, QObject *parent)
+    :QObject(parent)
+{
+    _model = model;
+}
+
+RemoteClient::~RemoteClient()
+{
+    close();
+}
+
+bool RemoteClient::connectTo(const QString &address)
+{
+    close();
+
+    QString host;
+    quint16 port;
+    if(RemoteProtocol::splitTcp(address, host, port))
+    {
+        QTcpSocket *socket = new QTcpSocket(this);
+        socket->connectToHost(host, port);
+        if(!socket->waitForConnected(connectTimeoutMs))
+        {
+            _errorString = socket->errorString();
+            delete socket;
+            return false;
+        }
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        connect(socket, &QTcpSocket::disconnected, this, &RemoteClient::disconnected);
+        _socket = socket;
+    }
+    else
+    {
+        QLocalSocket *socket = new QLocalSocket(this);
+        socket->connectToServer(address);
+        if(!socket->waitForConnected(connectTimeoutMs))
+        {
+            _errorString = socket->errorString();
+            delete socket;
+            return false;
+        }
+        connect(socket, &QLocalSocket::disconnected, this, &RemoteClient::disconnected);
+        _socket = socket;
+    }
+    connect(_socket, &QIODevice::readyRead, this, &RemoteClient::readMessages);
+    return true;
+}
+
+void RemoteClient::close()
+{
+    if(!_socket) return;
+
+    disconnect(_socket, nullptr, this, nullptr);
+    delete _socket;
+    _socket = nullptr;
+    _rx.clear();
+}
+
+void RemoteClient::sendCommand(RemoteProtocol::CommandType command, bool value)
+{
+    if(_socket) _socket->write(RemoteProtocol::encodeCommand(command, value));
+}
+
+void RemoteClient::readMessages()
+{
+    _rx.append(_socket->readAll());
+    QByteArray payload;
+    while(RemoteProtocol::takeMessage(_rx, payload))
+    {
+        RemoteUpdate update;
+        if(!RemoteProtocol::decodeUpdate(payload, update)) continue;
+        _stats = update.stats;
+        _model->applyRemote(update);
+    }
+}
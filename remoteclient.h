@@ -0,0 +1,41 @@
+#ifndef REMOTECLIENT_H
+#define REMOTECLIENT_H
+
+#include <QObject>
+#include "remoteprotocol.h"
+
+class LogModel;
+class QIODevice;
+
+// Thin client of a CaptureServer, mirrors the server rows into a LogModel.
+class RemoteClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RemoteClient(LogModel *model, QObject *parent = nullptr);
+    ~RemoteClient();
+
+    // a local socket name, or host:port for TCP
+    bool connectTo(const QString &address);
+    void close();
+    void sendCommand(RemoteProtocol::CommandType command, bool value = false);
+
+    QString errorString() const { return _errorString; }
+    QString stats() const { return _stats; }
+
+signals:
+    void disconnected();
+
+private slots:
+    void readMessages();
+
+private:
+    LogModel *_model = nullptr;
+    QIODevice *_socket = nullptr;
+    QByteArray _rx;
+    QString _stats;
+    QString _errorString;
+};
+
+#endif // REMOTECLIENT_H
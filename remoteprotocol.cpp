@@ -0,0 +1,127 @@
+#include "remoteprotocol.h"
+#include <QtEndian>
+
+const int messageHeaderSize = 4;
+// larger messages are taken for a broken stream
+const quint32 maxMessageSize = 256 * 1024 * 1024;
+
+QDataStream &RemoteProtocol::prepare(QDataStream &stream)
+{
+    // both ends may run different Qt versions
+    stream.setVersion(QDataStream::Qt_5_6);
+    return stream;
+}
+
+static QByteArray frame(const QByteArray &payload)
+{
+    QByteArray res(messageHeaderSize, Qt::Uninitialized);
+    qToLittleEndian<quint32>(payload.size(), reinterpret_cast<uchar *>(res.data()));
+    res.append(payload);
+    return res;
+}
+
+QByteArray RemoteProtocol::encodeUpdate(const RemoteUpdate &update)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    prepare(out) << quint8(Update) << update;
+    return frame(payload);
+}
+
+QByteArray RemoteProtocol::encodeCommand(CommandType command, bool value)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    prepare(out) << quint8(Command) << quint8(command) << value;
+    return frame(payload);
+}
+
+bool RemoteProtocol::decodeUpdate(const QByteArray &payload, RemoteUpdate &update)
+{
+    QDataStream in(payload);
+    prepare(in);
+    quint8 type;
+    in >> type;
+    if((in.status() != QDataStream::Ok) || (type != Update)) return false;
+    in >> update;
+    return in.status() == QDataStream::Ok;
+}
+
+bool RemoteProtocol::decodeCommand(const QByteArray &payload, CommandType &command, bool &value)
+{
+    QDataStream in(payload);
+    prepare(in);
+    quint8 type;
+    quint8 cmd;
+    in >> type >> cmd >> value;
+    if((in.status() != QDataStream::Ok) || (type != Command)) return false;
+    command = CommandType(cmd);
+    return true;
+}
+
+bool RemoteProtocol::takeMessage(QByteArray &buffer, QByteArray &payload)
+{
+    if(buffer.size() < messageHeaderSize) return false;
+    quint32 len = qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(buffer.constData()));
+    if(len > maxMessageSize)
+    {
+        buffer.clear();
+        return false;
+    }
+    if(quint32(buffer.size() - messageHeaderSize) < len) return false;
+
+    payload = buffer.mid(messageHeaderSize, len);
+    buffer.remove(0, messageHeaderSize + len);
+    return true;
+}
+
+// host:port is TCP, anything else names a local socket
+bool RemoteProtocol::isTcp(const QString &address)
+{
+    QString host;
+    quint16 port;
+    return splitTcp(address, host, port);
+}
+
+bool RemoteProtocol::splitTcp(const QString &address, QString &host, quint16 &port)
+{
+    int colon = address.lastIndexOf(':');
+    if(colon < 0) return false;
+    bool ok;
+    port = address.mid(colon + 1).toUShort(&ok);
+    if(!ok) return false;
+    host = address.left(colon);
+    return true;
+}
+
+QDataStream &operator<<(QDataStream &out, const RemoteChange &change)
+{
+    return out << change.sec << change.usec << change.data << change.delta;
+}
+
+QDataStream &operator>>(QDataStream &in, RemoteChange &change)
+{
+    return in >> change.sec >> change.usec >> change.data >> change.delta;
+}
+
+QDataStream &operator<<(QDataStream &out, const RemoteRow &row)
+{
+    return out << row.can << row.id << row.length << row.status << row.data << row.bitmask
+               << row.chbits << row.known << row.changeBase << row.changes;
+}
+
+QDataStream &operator>>(QDataStream &in, RemoteRow &row)
+{
+    return in >> row.can >> row.id >> row.length >> row.status >> row.data >> row.bitmask
+              >> row.chbits >> row.known >> row.changeBase >> row.changes;
+}
+
+QDataStream &operator<<(QDataStream &out, const RemoteUpdate &update)
+{
+    return out << update.snapshot << update.generation << update.firstTimestamp << update.lastTimestamp << update.stats << update.rows;
+}
+
+QDataStream &operator>>(QDataStream &in, RemoteUpdate &update)
+{
+    return in >> update.snapshot >> update.generation >> update.firstTimestamp >> update.lastTimestamp >> update.stats >> update.rows;
+}
@@ -0,0 +1,74 @@
+#ifndef REMOTEPROTOCOL_H
+#define REMOTEPROTOCOL_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QString>
+#include <QVector>
+
+// Messages between the capture server and attached GUIs. Each message is a
+// little-endian u32 length followed by a QDataStream payload.
+
+class RemoteChange
+{
+public:
+    quint64 sec = 0;
+    quint32 usec = 0;
+    quint64 data = 0;
+    quint64 delta = 0;
+};
+
+// State of one ID plus the change log entries added since the last update.
+class RemoteRow
+{
+public:
+    QString can;
+    quint32 id = 0;
+    quint8 length = 0;
+    quint8 status = 0;
+    quint64 data = 0;
+    quint64 bitmask = 0;
+    quint64 chbits = 0;
+    quint64 known = 0;
+    quint32 changeBase = 0;     // log position of the first entry in changes
+    QVector<RemoteChange> changes;
+};
+
+class RemoteUpdate
+{
+public:
+    bool snapshot = false;
+    quint32 generation = 0;     // deltas only apply on top of a snapshot of the same one
+    quint64 firstTimestamp = 0;
+    quint64 lastTimestamp = 0;
+    QString stats;
+    QVector<RemoteRow> rows;
+};
+
+class RemoteProtocol
+{
+public:
+    enum MessageType { Update = 1, Command = 2 };
+    enum CommandType { SetLogChange = 1, SetGenMask, SetFiltering, ClearStatus, ClearMasks, ClearChanges };
+
+    static QByteArray encodeUpdate(const RemoteUpdate &update);
+    static QByteArray encodeCommand(CommandType command, bool value = false);
+    // false for other message types and malformed payloads
+    static bool decodeUpdate(const QByteArray &payload, RemoteUpdate &update);
+    static bool decodeCommand(const QByteArray &payload, CommandType &command, bool &value);
+    // takes one complete message off the front of buffer
+    static bool takeMessage(QByteArray &buffer, QByteArray &payload);
+    static QDataStream &prepare(QDataStream &stream);
+
+    static bool isTcp(const QString &address);
+    static bool splitTcp(const QString &address, QString &host, quint16 &port);
+};
+
+QDataStream &operator<<(QDataStream &out, const RemoteChange &change);
+QDataStream &operator>>(QDataStream &in, RemoteChange &change);
+QDataStream &operator<<(QDataStream &out, const RemoteRow &row);
+QDataStream &operator>>(QDataStream &in, RemoteRow &row);
+QDataStream &operator<<(QDataStream &out, const RemoteUpdate &update);
+QDataStream &operator>>(QDataStream &in, RemoteUpdate &update);
+
+#endif // REMOTEPROTOCOL_H
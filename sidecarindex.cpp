@@ -0,0 +1,245 @@
+#include "sidecarindex.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include "logmodel.h"
+#include "tracer.h"
+
+const quint32 indexMagic = 0x58444943;     // "CIDX"
+const quint32 indexVersion = 4;
+// timestamps, log and file offset of a checkpoint in the footer
+const qint64 checkpointEntrySize = 32;
+// smallest per-ID entry, a null bus name, the ID and the range count
+const qint64 idEntrySize = 12;
+const qint64 rangeSize = 16;
+
+QString SidecarIndex::path(const QString &log)
+{
+    return log + QString(".cidx");
+}
+
+static qint64 modified(const QString &log)
+{
+    return QFileInfo(log).lastModified().toMSecsSinceEpoch();
+}
+
+static QDataStream &operator<<(QDataStream &out, const SidecarIndex::Settings &settings)
+{
+    quint8 modes = (settings.logChange ? 1 : 0) | (settings.genMask ? 2 : 0) | (settings.filtering ? 4 : 0);
+    return out << modes << settings.masks;
+}
+
+static QDataStream &operator>>(QDataStream &in, SidecarIndex::Settings &settings)
+{
+    quint8 modes;
+    in >> modes >> settings.masks;
+    settings.logChange = modes & 1;
+    settings.genMask = modes & 2;
+    settings.filtering = modes & 4;
+    return in;
+}
+
+bool SidecarIndex::create(const QString &log, BusTable *buses, const Settings &settings)
+{
+    _log = log;
+    _buses = buses;
+    _checkpoints.clear();
+    _logged.clear();
+    _ranges.clear();
+    _nextCheckpoint = _interval;
+
+    _out.reset(new QSaveFile(path(log)));
+    if(!_out->open(QIODevice::WriteOnly))
+    {
+        _errorString = _out->errorString();
+        _out.reset();
+        return false;
+    }
+    QDataStream out(_out.data());
+    RemoteProtocol::prepare(out) << indexMagic << indexVersion << QFileInfo(log).size() << modified(log) << settings;
+    return true;
+}
+
+void SidecarIndex::addBatch(const CANFrame *frames, int count, qint64 start, qint64 end, const LogModel &model)
+{
+    if(!_out) return;
+
+    for(int i = 0; i < count; i++)
+    {
+        QVector<Range> &ranges = _ranges[(quint64(frames[i].bus) << 32) | frames[i].id];
+        if(!ranges.isEmpty() && (ranges.last().end == end)) continue;
+        // an ID in back to back batches keeps one range
+        if(!ranges.isEmpty() && (ranges.last().end == start)) ranges.last().end = end;
+        else ranges.append({ start, end });
+    }
+
+    if(end < _nextCheckpoint) return;
+    writeCheckpoint(model, end);
+    _nextCheckpoint = end + _interval;
+}
+
+void SidecarIndex::writeCheckpoint(const LogModel &model, qint64 logOffset)
+{
+    TRACE_SCOPE("checkpoint");
+    Checkpoint checkpoint;
+    checkpoint.firstTimestamp = model.firstTimestamp();
+    checkpoint.timestamp = model.lastTimestamp();
+    checkpoint.logOffset = logOffset;
+    checkpoint.fileOffset = _out->pos();
+    _checkpoints.append(checkpoint);
+
+    // rows keep their positions while a log loads
+    RemoteUpdate state;
+    state.firstTimestamp = model.firstTimestamp();
+    state.lastTimestamp = model.lastTimestamp();
+    int rows = model.rowCount();
+    int written = _logged.size();
+    _logged.resize(rows);
+    state.rows.reserve(rows);
+    for(int i = 0; i < rows; i++)
+    {
+        const CANMessage &msg = model.message(i);
+        Logged &logged = _logged[i];
+        bool fresh = (i >= written) || (logged.epoch != msg.logEpoch);
+        state.rows.append(model.exportRow(i, fresh ? 0 : logged.count));
+        logged.epoch = msg.logEpoch;
+        logged.count = msg.changeLog.size();
+    }
+
+    QDataStream out(_out.data());
+    RemoteProtocol::prepare(out) << state;
+    for(int i = 0; i < rows; i++) out << model.message(i).detector;
+}
+
+bool SidecarIndex::finish(const LogModel &model)
+{
+    if(!_out) return false;
+
+    // the last checkpoint is the state of the whole log
+    writeCheckpoint(model, QFileInfo(_log).size());
+
+    qint64 footer = _out->pos();
+    QDataStream out(_out.data());
+    RemoteProtocol::prepare(out) << quint32(_checkpoints.size());
+    for(const Checkpoint &checkpoint : _checkpoints)
+    {
+        out << checkpoint.firstTimestamp << checkpoint.timestamp << checkpoint.logOffset << checkpoint.fileOffset;
+    }
+    out << quint32(_ranges.size());
+    for(QHash<quint64, QVector<Range>>::const_iterator it = _ranges.constBegin(); it != _ranges.constEnd(); ++it)
+    {
+        out << _buses->name(quint16(it.key() >> 32)) << quint32(it.key()) << quint32(it->size());
+        for(const Range &range : *it) out << range.start << range.end;
+    }
+    _ranges.clear();
+    out << footer << indexMagic;
+
+    bool ok = (out.status() == QDataStream::Ok) && _out->commit();
+    if(!ok) _errorString = _out->errorString();
+    _out.reset();
+    return ok;
+}
+
+bool SidecarIndex::open(const QString &log)
+{
+    _log = log;
+    _settings = Settings();
+    _checkpoints.clear();
+    _idRanges.clear();
+    _in.close();
+    _in.setFileName(path(log));
+    if(!_in.open(QIODevice::ReadOnly))
+    {
+        _errorString = _in.errorString();
+        return false;
+    }
+
+    QDataStream in(&_in);
+    RemoteProtocol::prepare(in);
+    quint32 magic;
+    quint32 version;
+    qint64 size;
+    qint64 mtime;
+    in >> magic >> version;
+    if((magic != indexMagic) || (version != indexVersion))
+    {
+        _errorString = QString("Not a log index");
+        return false;
+    }
+    in >> size >> mtime >> _settings;
+    if((size != QFileInfo(log).size()) || (mtime != modified(log)))
+    {
+        _errorString = QString("Log changed since it was indexed");
+        return false;
+    }
+
+    qint64 footer;
+    quint32 trailer;
+    _in.seek(_in.size() - qint64(sizeof(footer) + sizeof(trailer)));
+    in >> footer >> trailer;
+    if((trailer != indexMagic) || !_in.seek(footer))
+    {
+        _errorString = QString("Truncated log index");
+        return false;
+    }
+
+    // counts are checked against the bytes left before anything is allocated
+    qint64 end = _in.size() - qint64(sizeof(footer) + sizeof(trailer));
+    quint32 count;
+    in >> count;
+    bool ok = (in.status() == QDataStream::Ok) && (qint64(count) <= ((end - _in.pos()) / checkpointEntrySize));
+    if(ok)
+    {
+        _checkpoints.resize(count);
+        for(Checkpoint &checkpoint : _checkpoints)
+        {
+            in >> checkpoint.firstTimestamp >> checkpoint.timestamp >> checkpoint.logOffset >> checkpoint.fileOffset;
+        }
+        in >> count;
+        ok = (in.status() == QDataStream::Ok) && (qint64(count) <= ((end - _in.pos()) / idEntrySize));
+    }
+    for(quint32 i = 0; ok && (i < count); i++)
+    {
+        QString bus;
+        quint32 id;
+        quint32 n;
+        in >> bus >> id >> n;
+        ok = (in.status() == QDataStream::Ok) && (qint64(n) <= ((end - _in.pos()) / rangeSize));
+        if(!ok) break;
+        QVector<Range> &ranges = _idRanges[Key(bus, id)];
+        ranges.resize(n);
+        for(Range &range : ranges) in >> range.start >> range.end;
+    }
+    if(!ok || (in.status() != QDataStream::Ok))
+    {
+        _errorString = QString("Corrupt log index");
+        _checkpoints.clear();
+        _idRanges.clear();
+        return false;
+    }
+    return true;
+}
+
+int SidecarIndex::nearest(quint64 ts) const
+{
+    int res = -1;
+    for(int i = 0; i < _checkpoints.size(); i++)
+    {
+        if(_checkpoints[i].timestamp > ts) break;
+        res = i;
+    }
+    return res;
+}
+
+bool SidecarIndex::checkpoint(int ix, RemoteUpdate &state, QVector<SignalDetector> &detectors, qint64 &logOffset)
+{
+    if((ix < 0) || (ix >= _checkpoints.size()) || !_in.seek(_checkpoints[ix].fileOffset)) return false;
+
+    QDataStream in(&_in);
+    RemoteProtocol::prepare(in) >> state;
+    if(in.status() != QDataStream::Ok) return false;
+    detectors.resize(state.rows.size());
+    for(SignalDetector &detector : detectors) in >> detector;
+    logOffset = _checkpoints[ix].logOffset;
+    return in.status() == QDataStream::Ok;
+}
@@ -0,0 +1,104 @@
+#ifndef SIDECARINDEX_H
+#define SIDECARINDEX_H
+
+#include <QHash>
+#include <QPair>
+#include <QSaveFile>
+#include <QScopedPointer>
+#include <QVector>
+#include "canframe.h"
+#include "remoteprotocol.h"
+#include "signaldetector.h"
+
+class LogModel;
+
+// Index file next to a seekable log ("<log>.cidx"). Holds model state
+// checkpoints at regular log offsets and, per ID, the ranges of batches the
+// ID shows up in. Each checkpoint has the rows with the change log entries
+// added since the previous one and the detector states, so replaying
+// checkpoints up to one restores the full state at it. Checkpoints only hold
+// for the settings they were written under, the ranges for any.
+class SidecarIndex
+{
+public:
+    // what the checkpoints depend on besides the log
+    struct Settings
+    {
+        bool logChange = false;
+        bool genMask = false;
+        bool filtering = false;
+        QByteArray masks;       // Journal::maskDigest()
+
+        bool operator==(const Settings &other) const
+        {
+            return (logChange == other.logChange) && (genMask == other.genMask)
+                    && (filtering == other.filtering) && (masks == other.masks);
+        }
+        bool operator!=(const Settings &other) const { return !(*this == other); }
+    };
+    // log bytes of consecutive batches
+    struct Range
+    {
+        qint64 start;
+        qint64 end;
+    };
+
+    static const qint64 defaultInterval = 32 * 1024 * 1024;
+
+    static QString path(const QString &log);
+
+    // writing, while the log is loaded from its start
+    bool create(const QString &log, BusTable *buses, const Settings &settings);
+    // log bytes between checkpoints
+    void setInterval(qint64 bytes) { _interval = qMax(qint64(1), bytes); }
+    void addBatch(const CANFrame *frames, int count, qint64 start, qint64 end, const LogModel &model);
+    bool finish(const LogModel &model);
+
+    // reading, fails if the log changed since the index was written
+    bool open(const QString &log);
+    const Settings &settings() const { return _settings; }
+    int checkpoints() const { return _checkpoints.size(); }
+    // last checkpoint at or before ts, -1 if none
+    int nearest(quint64 ts) const;
+    // detectors are in the order of state.rows
+    bool checkpoint(int ix, RemoteUpdate &state, QVector<SignalDetector> &detectors, qint64 &logOffset);
+    // batches holding frames of the ID, in log order
+    QVector<Range> ranges(const QString &bus, quint32 id) const { return _idRanges.value(Key(bus, id)); }
+    quint64 firstTimestamp() const { return _checkpoints.isEmpty() ? 0 : _checkpoints.first().firstTimestamp; }
+    quint64 lastTimestamp() const { return _checkpoints.isEmpty() ? 0 : _checkpoints.last().timestamp; }
+
+    QString errorString() const { return _errorString; }
+
+private:
+    struct Checkpoint
+    {
+        quint64 firstTimestamp;
+        quint64 timestamp;
+        qint64 logOffset;
+        qint64 fileOffset;
+    };
+    // change log of a row as of the previous checkpoint
+    struct Logged
+    {
+        quint32 epoch;
+        quint32 count;
+    };
+    typedef QPair<QString, quint32> Key;
+
+    void writeCheckpoint(const LogModel &model, qint64 logOffset);
+
+    QString _log;
+    Settings _settings;
+    BusTable *_buses = nullptr;
+    QScopedPointer<QSaveFile> _out;
+    QFile _in;
+    QVector<Checkpoint> _checkpoints;
+    QVector<Logged> _logged;                    // by row while writing
+    QHash<quint64, QVector<Range>> _ranges;     // by bus handle and ID while writing
+    QHash<Key, QVector<Range>> _idRanges;       // by bus name and ID once read
+    qint64 _interval = defaultInterval;
+    qint64 _nextCheckpoint = 0;
+    QString _errorString;
+};
+
+#endif // SIDECARINDEX_H
@@ -0,0 +1,190 @@
+#include "signaldetector.h"
+#include <QStringList>
+
+// lane-wise increment without carries between lanes
+static quint64 laneIncrement(quint64 x, quint64 low, quint64 high)
+{
+    return ((x & ~high) + low) ^ (x & high);
+}
+
+void SignalDetector::Score::add(bool hit)
+{
+    seen++;
+    if(!hit) misses++;
+    // old samples fade out, keeps the counters small
+    if(seen >= 1024)
+    {
+        seen /= 2;
+        misses /= 2;
+    }
+}
+
+void SignalDetector::reset()
+{
+    *this = SignalDetector();
+}
+
+quint64 SignalDetector::feed(quint64 data, quint8 length)
+{
+    if(length != _length)
+    {
+        reset();
+        _length = length;
+    }
+    if(!_primed)
+    {
+        _last = data;
+        _primed = true;
+        return _known;
+    }
+
+    // counters, every nibble and byte checked at once
+    quint64 nibbleInc = ~(laneIncrement(_last, 0x1111111111111111ULL, 0x8888888888888888ULL) ^ data);
+    quint64 byteInc = ~(laneIncrement(_last, 0x0101010101010101ULL, 0x8080808080808080ULL) ^ data);
+    for(int i = 0; i < (_length * 2); i++)
+    {
+        _nibbles[i].add(((nibbleInc >> (i * 4)) & 0xf) == 0xf);
+    }
+    for(int i = 0; i < _length; i++)
+    {
+        _bytes[i].add(((byteInc >> (i * 8)) & 0xff) == 0xff);
+    }
+
+    // checksums in the first or the last byte
+    if(_length >= 2)
+    {
+        quint8 bytes[8];
+        for(int i = 0; i < _length; i++) bytes[i] = quint8(data >> ((_length - 1 - i) * 8));
+        for(int type = 0; type < ChecksumEnd; type++)
+        {
+            // over a single byte XOR and sum copy it, two equal bytes are no checksum
+            if((_length == 2) && ((type == Xor) || (type == Sum))) continue;
+            _checksums[First][type].add(checksum(Checksum(type), bytes + 1, _length - 1) == bytes[0]);
+            _checksums[Last][type].add(checksum(Checksum(type), bytes, _length - 1) == bytes[_length - 1]);
+        }
+    }
+    _last = data;
+
+    _known = 0;
+    for(int i = 0; i < (_length * 2); i++)
+    {
+        if(_nibbles[i].confirmed()) _known |= quint64(0xf) << (i * 4);
+    }
+    for(int i = 0; i < _length; i++)
+    {
+        if(_bytes[i].confirmed()) _known |= quint64(0xff) << (i * 8);
+    }
+    for(int type = 0; type < ChecksumEnd; type++)
+    {
+        // a XOR over the whole frame cannot tell its position, the last byte is the usual one
+        if((type != Xor) && _checksums[First][type].confirmed()) _known |= quint64(0xff) << ((_length - 1) * 8);
+        if(_checksums[Last][type].confirmed()) _known |= 0xff;
+    }
+    return _known;
+}
+
+QString SignalDetector::describe() const
+{
+    QStringList res;
+    for(int i = 0; i < _length; i++)
+    {
+        if(_bytes[i].confirmed()) res.append(QString("counter byte %1").arg(_length - 1 - i));
+    }
+    for(int i = 0; i < (_length * 2); i++)
+    {
+        if(!_nibbles[i].confirmed() || _bytes[i / 2].confirmed()) continue;
+        res.append(QString("counter nibble %1.%2").arg(_length - 1 - (i / 2)).arg((i % 2) ? "hi" : "lo"));
+    }
+    for(int type = 0; type < ChecksumEnd; type++)
+    {
+        if((type != Xor) && _checksums[First][type].confirmed())
+            res.append(QString("%1 byte 0").arg(checksumName(Checksum(type))));
+        if(_checksums[Last][type].confirmed())
+            res.append(QString("%1 byte %2").arg(checksumName(Checksum(type))).arg(_length - 1));
+    }
+    return res.join(", ");
+}
+
+quint8 SignalDetector::crc8(const quint8 *data, int len, quint8 init, quint8 xorout)
+{
+    // polynomial 0x1d, as in SAE J1850 and AUTOSAR E2E profile 1
+    static const struct Table
+    {
+        Table()
+        {
+            for(int i = 0; i < 256; i++)
+            {
+                quint8 crc = i;
+                for(int j = 0; j < 8; j++) crc = (crc & 0x80) ? quint8((crc << 1) ^ 0x1d) : quint8(crc << 1);
+                values[i] = crc;
+            }
+        }
+        quint8 values[256];
+    } table;
+
+    quint8 crc = init;
+    for(int i = 0; i < len; i++) crc = table.values[crc ^ data[i]];
+    return crc ^ xorout;
+}
+
+quint8 SignalDetector::checksum(Checksum type, const quint8 *data, int len)
+{
+    quint8 res = 0;
+    switch(type)
+    {
+    case Xor:
+        for(int i = 0; i < len; i++) res ^= data[i];
+        return res;
+    case Sum:
+        for(int i = 0; i < len; i++) res += data[i];
+        return res;
+    case Crc8J1850:
+        return crc8(data, len, 0xff, 0xff);
+    case Crc8J1850Zero:
+        return crc8(data, len, 0x00, 0x00);
+    default:
+        return 0;
+    }
+}
+
+QString SignalDetector::checksumName(Checksum type)
+{
+    switch(type)
+    {
+    case Xor:
+        return QString("XOR");
+    case Sum:
+        return QString("sum");
+    case Crc8J1850:
+        return QString("CRC-8 J1850");
+    case Crc8J1850Zero:
+        return QString("CRC-8 J1850/zero");
+    default:
+        return QString();
+    }
+}
+
+QDataStream &operator<<(QDataStream &out, const SignalDetector &detector)
+{
+    out << detector._last << detector._length << detector._primed << detector._known;
+    for(const SignalDetector::Score &score : detector._nibbles) out << score.seen << score.misses;
+    for(const SignalDetector::Score &score : detector._bytes) out << score.seen << score.misses;
+    for(const auto &position : detector._checksums)
+    {
+        for(const SignalDetector::Score &score : position) out << score.seen << score.misses;
+    }
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, SignalDetector &detector)
+{
+    in >> detector._last >> detector._length >> detector._primed >> detector._known;
+    for(SignalDetector::Score &score : detector._nibbles) in >> score.seen >> score.misses;
+    for(SignalDetector::Score &score : detector._bytes) in >> score.seen >> score.misses;
+    for(auto &position : detector._checksums)
+    {
+        for(SignalDetector::Score &score : position) in >> score.seen >> score.misses;
+    }
+    if(detector._length > 8) detector.reset();
+    return in;
+}
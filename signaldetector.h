@@ -0,0 +1,50 @@
+#ifndef SIGNALDETECTOR_H
+#define SIGNALDETECTOR_H
+
+#include <QDataStream>
+#include <QString>
+
+// Streaming per-ID detector of alive counters and checksum bytes.
+// Payloads use the CANFrame::payload() layout, byte 0 most significant.
+class SignalDetector
+{
+public:
+    enum Checksum { Xor = 0, Sum, Crc8J1850, Crc8J1850Zero, ChecksumEnd };
+
+    // returns the bits known to be counters or checksums
+    quint64 feed(quint64 data, quint8 length);
+    void reset();
+    quint64 known() const { return _known; }
+    QString describe() const;
+
+    static quint8 crc8(const quint8 *data, int len, quint8 init, quint8 xorout);
+    static quint8 checksum(Checksum type, const quint8 *data, int len);
+    static QString checksumName(Checksum type);
+
+    // the whole learned state, for index checkpoints
+    friend QDataStream &operator<<(QDataStream &out, const SignalDetector &detector);
+    friend QDataStream &operator>>(QDataStream &in, SignalDetector &detector);
+
+protected:
+    class Score
+    {
+    public:
+        void add(bool hit);
+        bool confirmed() const { return (seen >= 16) && ((misses * 32) <= seen); }
+
+        quint16 seen = 0;
+        quint16 misses = 0;
+    };
+
+    enum { First = 0, Last = 1 };
+
+    quint64 _last = 0;
+    quint8 _length = 0;
+    bool _primed = false;
+    quint64 _known = 0;
+    Score _nibbles[16];
+    Score _bytes[8];
+    Score _checksums[2][ChecksumEnd];
+};
+
+#endif // SIGNALDETECTOR_H
@@ -0,0 +1,245 @@
+#include "socketcansource.h"
+#include <QDir>
+#include <QFile>
+#include <QSocketNotifier>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include "logmodel.h"
+#include "tracer.h"
+
+const int rxBatch = 64;
+const int rxBufferSize = 8 * 1024 * 1024;
+const int ARPHRD_CAN_TYPE = 280;
+// room for SCM_TIMESTAMPING, SCM_TIMESTAMPNS and SO_RXQ_OVFL per datagram
+const int rxControlSize = CMSG_SPACE(sizeof(scm_timestamping)) + CMSG_SPACE(sizeof(timespec))
+        + CMSG_SPACE(sizeof(quint32));
+
+SocketCanSource::SocketCanSource(LogModel *model, QObject *parent)
+    :QObject(parent)
+{
+    _model = model;
+}
+
+SocketCanSource::~SocketCanSource()
+{
+    close();
+}
+
+QStringList SocketCanSource::interfaces()
+{
+    QStringList res;
+    QDir net("/sys/class/net");
+    const QStringList names = net.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for(const QString &name : names)
+    {
+        QFile type(net.filePath(name + "/type"));
+        if(!type.open(QIODevice::ReadOnly)) continue;
+        if(type.readAll().trimmed().toInt() == ARPHRD_CAN_TYPE) res.append(name);
+    }
+    return res;
+}
+
+bool SocketCanSource::open(const QString &interface)
+{
+    close();
+
+    int fd = ::socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, CAN_RAW);
+    if(fd < 0)
+    {
+        setError(QString("socket"));
+        return false;
+    }
+
+    // FD frames are optional, classic-only kernels refuse the option
+    int on = 1;
+    setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &on, sizeof(on));
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    QByteArray name = interface.toLocal8Bit();
+    strncpy(ifr.ifr_name, name.constData(), IFNAMSIZ - 1);
+    if(ioctl(fd, SIOCGIFINDEX, &ifr) < 0)
+    {
+        setError(interface);
+        ::close(fd);
+        return false;
+    }
+
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    if(bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        setError(QString("bind"));
+        ::close(fd);
+        return false;
+    }
+
+    _fd = fd;
+    setup(interface);
+    return true;
+}
+
+bool SocketCanSource::openDescriptor(int fd, const QString &name)
+{
+    close();
+    if(fd < 0) return false;
+
+    int flags = fcntl(fd, F_GETFL);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    _fd = fd;
+    setup(name);
+    return true;
+}
+
+void SocketCanSource::setup(const QString &name)
+{
+    // SO_RCVBUFFORCE needs CAP_NET_ADMIN, otherwise rmem_max caps the request
+    int size = rxBufferSize;
+    if(setsockopt(_fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0)
+        setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    int on = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on));
+
+    int tsflags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE
+            | SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if(setsockopt(_fd, SOL_SOCKET, SO_TIMESTAMPING, &tsflags, sizeof(tsflags)) < 0)
+        setsockopt(_fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+
+    _bus = _model->buses()->handle(name);
+    _drops = 0;
+
+    _rx.resize(rxBatch);
+    _hdrs.resize(rxBatch);
+    _iov.resize(rxBatch);
+    _control.resize(rxBatch * rxControlSize);
+    _frames.resize(rxBatch);
+    for(int i = 0; i < rxBatch; i++)
+    {
+        _iov[i].iov_base = &_rx[i];
+        _iov[i].iov_len = sizeof(canfd_frame);
+        memset(&_hdrs[i], 0, sizeof(mmsghdr));
+        _hdrs[i].msg_hdr.msg_iov = &_iov[i];
+        _hdrs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    _notifier = new QSocketNotifier(_fd, QSocketNotifier::Read, this);
+    connect(_notifier, SIGNAL(activated(int)), this, SLOT(readFrames()));
+}
+
+void SocketCanSource::close()
+{
+    if(_fd < 0) return;
+
+    delete _notifier;
+    _notifier = nullptr;
+    ::close(_fd);
+    _fd = -1;
+}
+
+void SocketCanSource::setError(const QString &what)
+{
+    _errorString = QString("%1: %2").arg(what).arg(QString::fromLocal8Bit(strerror(errno)));
+}
+
+void SocketCanSource::readFrames()
+{
+    TRACE_SCOPE("SocketCanSource::readFrames");
+
+    for(;;)
+    {
+        for(int i = 0; i < rxBatch; i++)
+        {
+            _hdrs[i].msg_hdr.msg_control = _control.data() + i * rxControlSize;
+            _hdrs[i].msg_hdr.msg_controllen = rxControlSize;
+        }
+
+        int n = recvmmsg(_fd, _hdrs.data(), rxBatch, MSG_DONTWAIT, nullptr);
+        if(n < 0)
+        {
+            if((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+            {
+                setError(QString("recvmmsg"));
+                emit errorOccurred(_errorString);
+                _notifier->setEnabled(false);
+            }
+            break;
+        }
+
+        // stand-in sockets deliver no timestamps
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+
+        int count = 0;
+        for(int i = 0; i < n; i++)
+        {
+            struct timespec ts = now;
+            parseControl(&_hdrs[i].msg_hdr, ts, _drops);
+            if(convert(_rx[i], _hdrs[i].msg_len, ts, _bus, _frames[count])) count++;
+        }
+
+        if(count > 0) _model->procFrames(_frames.constData(), count);
+        _model->stats()->set(PipelineStats::KernelDrops, _drops);
+
+        if(n < rxBatch) break;
+    }
+}
+
+void SocketCanSource::parseControl(msghdr *hdr, timespec &ts, quint32 &drops)
+{
+    for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(hdr); cmsg; cmsg = CMSG_NXTHDR(hdr, cmsg))
+    {
+        if(cmsg->cmsg_level != SOL_SOCKET) continue;
+        if((cmsg->cmsg_type == SCM_TIMESTAMPING) && (cmsg->cmsg_len >= CMSG_LEN(sizeof(scm_timestamping))))
+        {
+            struct scm_timestamping stamps;
+            memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+            // raw hardware stamp when the controller provides one
+            ts = (stamps.ts[2].tv_sec || stamps.ts[2].tv_nsec) ? stamps.ts[2] : stamps.ts[0];
+        }
+        else if((cmsg->cmsg_type == SCM_TIMESTAMPNS) && (cmsg->cmsg_len >= CMSG_LEN(sizeof(timespec))))
+        {
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+        }
+        else if((cmsg->cmsg_type == SO_RXQ_OVFL) && (cmsg->cmsg_len >= CMSG_LEN(sizeof(quint32))))
+        {
+            memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+        }
+    }
+}
+
+bool SocketCanSource::convert(const canfd_frame &rx, unsigned int len, const timespec &ts, quint16 bus, CANFrame &f)
+{
+    if((len != CAN_MTU) && (len != CANFD_MTU)) return false;
+
+    f.sec = ts.tv_sec;
+    f.usec = ts.tv_nsec / 1000;
+    f.bus = bus;
+    f.flags = 0;
+    if(rx.can_id & CAN_EFF_FLAG)
+    {
+        f.flags |= CANFrame::Extended;
+        f.id = rx.can_id & CAN_EFF_MASK;
+    }
+    else
+    {
+        f.id = rx.can_id & CAN_SFF_MASK;
+    }
+    if(rx.can_id & CAN_RTR_FLAG) f.flags |= CANFrame::Remote;
+    if(rx.can_id & CAN_ERR_FLAG) f.flags |= CANFrame::Error;
+    if(len == CANFD_MTU) f.flags |= CANFrame::FD;
+    f.length = (rx.len > CANFD_MAX_DLEN) ? CANFD_MAX_DLEN : rx.len;
+    if(!(f.flags & CANFrame::FD) && (f.length > CAN_MAX_DLEN)) f.length = CAN_MAX_DLEN;
+    memcpy(f.data, rx.data, f.length);
+    return true;
+}
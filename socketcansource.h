@@ -0,0 +1,66 @@
+#ifndef SOCKETCANSOURCE_H
+#define SOCKETCANSOURCE_H
+
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+#include <sys/socket.h>
+#include <ctime>
+#include <linux/can.h>
+#include "canframe.h"
+
+class LogModel;
+class QSocketNotifier;
+
+// Raw SocketCAN reader bypassing the QCanBus plugin layer.
+// Frames are received in batches with recvmmsg and go straight to LogModel::procFrames.
+class SocketCanSource : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SocketCanSource(LogModel *model, QObject *parent = nullptr);
+    ~SocketCanSource();
+
+    bool open(const QString &interface);
+    // adopts an already connected datagram socket, e.g. one end of a socketpair
+    bool openDescriptor(int fd, const QString &name);
+    void close();
+    bool isOpen() const { return _fd >= 0; }
+
+    QString errorString() const { return _errorString; }
+    quint32 drops() const { return _drops; }
+
+    static QString pluginName() { return QString("socketcan (native)"); }
+    static QStringList interfaces();
+
+    // receive timestamp and kernel drop counter from one datagram's control messages
+    static void parseControl(msghdr *hdr, timespec &ts, quint32 &drops);
+    // false for datagrams that are neither CAN_MTU nor CANFD_MTU long
+    static bool convert(const canfd_frame &rx, unsigned int len, const timespec &ts, quint16 bus, CANFrame &f);
+
+signals:
+    void errorOccurred(const QString &error);
+
+private slots:
+    void readFrames();
+
+private:
+    void setup(const QString &name);
+    void setError(const QString &what);
+
+    LogModel *_model = nullptr;
+    int _fd = -1;
+    QSocketNotifier *_notifier = nullptr;
+    quint16 _bus = BusTable::NoBus;
+    quint32 _drops = 0;
+    QString _errorString;
+
+    QVector<canfd_frame> _rx;
+    QVector<mmsghdr> _hdrs;
+    QVector<iovec> _iov;
+    QByteArray _control;
+    QVector<CANFrame> _frames;
+};
+
+#endif // SOCKETCANSOURCE_H
@@ -0,0 +1,5 @@
+include(../core.pri)
+
+TARGET = tst_blfreader
+
+SOURCES += tst_blfreader.cpp
@@ -0,0 +1,199 @@
+#include <QtTest>
+#include <QtEndian>
+#include <QTemporaryFile>
+#include <zlib.h>
+#include "blfreader.h"
+
+// Files are assembled in memory: a file header, then log containers holding
+// CAN_MESSAGE objects, with no measurement start so times stay relative.
+class TestBlfReader : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void compressed();
+    void splitObject();
+    void oversizedContainer();
+    void corruptContainer();
+    void garbage();
+
+private:
+    static void appendU16(QByteArray &out, quint16 value);
+    static void appendU32(QByteArray &out, quint32 value);
+    static QByteArray message(quint32 id, quint16 channel, quint64 tenMicros, quint8 value);
+    static QByteArray container(const QByteArray &objects, bool deflate, quint32 uncompressedSize = 0);
+    static QByteArray file(const QVector<QByteArray> &containers);
+    static int readAll(const QByteArray &blf, QVector<CANFrame> &frames);
+};
+
+const int fileHeaderSize = 144;
+
+void TestBlfReader::appendU16(QByteArray &out, quint16 value)
+{
+    uchar buf[2];
+    qToLittleEndian(value, buf);
+    out.append(reinterpret_cast<const char *>(buf), 2);
+}
+
+void TestBlfReader::appendU32(QByteArray &out, quint32 value)
+{
+    uchar buf[4];
+    qToLittleEndian(value, buf);
+    out.append(reinterpret_cast<const char *>(buf), 4);
+}
+
+// object header v1 with a 10 us timestamp, channel, flags, DLC, id, data
+QByteArray TestBlfReader::message(quint32 id, quint16 channel, quint64 tenMicros, quint8 value)
+{
+    QByteArray res("LOBJ");
+    appendU16(res, 32);
+    appendU16(res, 1);
+    appendU32(res, 48);
+    appendU32(res, 1);
+    appendU32(res, 1);
+    appendU32(res, 0);
+    appendU32(res, quint32(tenMicros));
+    appendU32(res, quint32(tenMicros >> 32));
+    appendU16(res, channel);
+    res.append('\0');
+    res.append('\x02');
+    appendU32(res, id);
+    res.append(char(value));
+    res.append(char(~value));
+    res.append(QByteArray(6, '\0'));
+    return res;
+}
+
+// objects padded to four bytes the way the reader skips them
+QByteArray TestBlfReader::container(const QByteArray &objects, bool deflate, quint32 uncompressedSize)
+{
+    QByteArray data = objects;
+    if(deflate)
+    {
+        uLongf len = compressBound(objects.size());
+        data.resize(int(len));
+        if(compress(reinterpret_cast<Bytef *>(data.data()), &len,
+                    reinterpret_cast<const Bytef *>(objects.constData()), objects.size()) != Z_OK) return QByteArray();
+        data.resize(int(len));
+    }
+
+    quint32 size = 32 + data.size();
+    QByteArray res("LOBJ");
+    appendU16(res, 16);
+    appendU16(res, 1);
+    appendU32(res, size);
+    appendU32(res, 10);
+    appendU16(res, deflate ? 2 : 0);
+    res.append(QByteArray(6, '\0'));
+    appendU32(res, uncompressedSize ? uncompressedSize : quint32(objects.size()));
+    appendU32(res, 0);
+    res.append(data);
+    res.append(QByteArray(size % 4, '\0'));
+    return res;
+}
+
+QByteArray TestBlfReader::file(const QVector<QByteArray> &containers)
+{
+    QByteArray res("LOGG");
+    appendU32(res, fileHeaderSize);
+    res.append(QByteArray(fileHeaderSize - 8, '\0'));
+    for(const QByteArray &c : containers) res.append(c);
+    return res;
+}
+
+int TestBlfReader::readAll(const QByteArray &blf, QVector<CANFrame> &frames)
+{
+    QTemporaryFile tmp;
+    if(!tmp.open()) return -1;
+    tmp.write(blf);
+    tmp.close();
+
+    BusTable buses;
+    BlfReader reader(&buses);
+    if(!reader.open(tmp.fileName())) return -1;
+    frames.resize(64);
+    int count = 0;
+    while(int n = reader.read(frames.data() + count, frames.size() - count)) count += n;
+    frames.resize(count);
+    return count;
+}
+
+void TestBlfReader::compressed()
+{
+    QByteArray objects = message(0x123, 1, 100, 0x11) + message(0x456 | 0x80000000U, 2, 200, 0x22);
+    QVector<CANFrame> frames;
+    QCOMPARE(readAll(file({ container(objects, true), container(message(0x789, 1, 300, 0x33), false) }), frames), 3);
+
+    QCOMPARE(frames[0].id, quint32(0x123));
+    QCOMPARE(int(frames[0].flags), 0);
+    QCOMPARE(int(frames[0].length), 2);
+    QCOMPARE(frames[0].payload(), quint64(0x11ee));
+    QCOMPARE(frames[0].timestamp(), quint64(1000));
+    QCOMPARE(frames[1].id, quint32(0x456));
+    QCOMPARE(int(frames[1].flags), int(CANFrame::Extended));
+    QCOMPARE(frames[1].timestamp(), quint64(2000));
+    QVERIFY(frames[1].bus != frames[0].bus);
+    QCOMPARE(frames[2].id, quint32(0x789));
+    QCOMPARE(frames[2].bus, frames[0].bus);
+    QCOMPARE(frames[2].payload(), quint64(0x33cc));
+}
+
+void TestBlfReader::splitObject()
+{
+    // the second object starts in one container and ends in the next
+    QByteArray objects = message(0x100, 1, 100, 1) + message(0x200, 1, 200, 2) + message(0x300, 1, 300, 3);
+    int cut = 48 + 20;
+    QVector<CANFrame> frames;
+    QCOMPARE(readAll(file({ container(objects.left(cut), true), container(objects.mid(cut), true) }), frames), 3);
+    QCOMPARE(frames[0].id, quint32(0x100));
+    QCOMPARE(frames[1].id, quint32(0x200));
+    QCOMPARE(frames[1].payload(), quint64(0x02fd));
+    QCOMPARE(frames[1].timestamp(), quint64(2000));
+    QCOMPARE(frames[2].id, quint32(0x300));
+}
+
+void TestBlfReader::oversizedContainer()
+{
+    // a claimed size far beyond any writer's is refused, not allocated; the
+    // object running into it is lost with it, later containers still load
+    QByteArray objects = message(0x100, 1, 100, 1) + message(0x200, 1, 200, 2).left(20);
+    QByteArray bad = container(message(0x300, 1, 300, 3), true, 0x80000000U);
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("^BLF: container at offset \\d+ could not be inflated"));
+    QVector<CANFrame> frames;
+    QCOMPARE(readAll(file({ container(objects, false), bad, container(message(0x400, 1, 400, 4), true) }), frames), 2);
+    QCOMPARE(frames[0].id, quint32(0x100));
+    QCOMPARE(frames[1].id, quint32(0x400));
+}
+
+void TestBlfReader::corruptContainer()
+{
+    // deflate data that does not inflate to the claimed size
+    QByteArray inner = message(0x300, 1, 300, 3);
+    QByteArray bad = container(inner, true, inner.size() + 4);
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("^BLF: container at offset \\d+ could not be inflated"));
+    QVector<CANFrame> frames;
+    QCOMPARE(readAll(file({ container(message(0x100, 1, 100, 1), true), bad,
+                            container(message(0x400, 1, 400, 4), false) }), frames), 2);
+    QCOMPARE(frames[0].id, quint32(0x100));
+    QCOMPARE(frames[1].id, quint32(0x400));
+
+    // a container running past the end of the file ends the index there
+    QByteArray truncated = container(message(0x500, 1, 500, 5), false);
+    truncated.chop(8);
+    QCOMPARE(readAll(file({ container(message(0x100, 1, 100, 1), true), truncated }), frames), 1);
+    QCOMPARE(frames[0].id, quint32(0x100));
+}
+
+void TestBlfReader::garbage()
+{
+    // junk between objects is skipped up to the next signature
+    QByteArray objects = message(0x100, 1, 100, 1) + QByteArray(40, '\x5a') + message(0x200, 1, 200, 2);
+    QTest::ignoreMessage(QtWarningMsg, "BLF: lost object sync, skipped 40 bytes");
+    QVector<CANFrame> frames;
+    QCOMPARE(readAll(file({ container(objects, true) }), frames), 2);
+    QCOMPARE(frames[0].id, quint32(0x100));
+    QCOMPARE(frames[1].id, quint32(0x200));
+}
+
+QTEST_GUILESS_MAIN(TestBlfReader)
+#include "tst_blfreader.moc"
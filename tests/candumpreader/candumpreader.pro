@@ -0,0 +1,5 @@
+include(../core.pri)
+
+TARGET = tst_candumpreader
+
+SOURCES += tst_candumpreader.cpp
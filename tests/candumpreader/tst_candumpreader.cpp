@@ -0,0 +1,116 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include "framereader.h"
+#include "logfollower.h"
+#include "logmodel.h"
+
+// Growing logs as a writer or a sync tool leaves them between two polls.
+class TestCandumpReader : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void lastLineAtEof();
+    void partialLine();
+    void truncated();
+    void followReplacedFile();
+
+private:
+    void write(const QString &fname, const QByteArray &data, bool append = false);
+
+    QTemporaryDir _dir;
+    QString _log;
+};
+
+void TestCandumpReader::init()
+{
+    QVERIFY(_dir.isValid());
+    _log = _dir.filePath(QTest::currentTestFunction() + QString(".log"));
+}
+
+void TestCandumpReader::write(const QString &fname, const QByteArray &data, bool append)
+{
+    QFile file(fname);
+    QVERIFY(file.open(append ? QIODevice::Append : QIODevice::WriteOnly));
+    QCOMPARE(file.write(data), qint64(data.size()));
+}
+
+void TestCandumpReader::lastLineAtEof()
+{
+    // without follow mode a last line without newline is complete
+    write(_log, "(1.000001) can0 123#01\n(1.000002) can0 123#02");
+    BusTable buses;
+    CandumpReader reader(&buses);
+    QVERIFY(reader.open(_log));
+    CANFrame frames[4];
+    QCOMPARE(reader.read(frames, 4), 2);
+    QCOMPARE(int(frames[1].data[0]), 2);
+}
+
+void TestCandumpReader::partialLine()
+{
+    write(_log, "(1.000001) can0 123#01\n(1.000002) can0 12");
+    BusTable buses;
+    CandumpReader reader(&buses);
+    QVERIFY(reader.open(_log));
+    reader.setFollow(true);
+    CANFrame frames[4];
+    QCOMPARE(reader.read(frames, 4), 1);
+    QCOMPARE(reader.pos(), qint64(23));
+
+    // the writer finishes the line, it is read whole from its start
+    write(_log, "3#0203\n(1.000003) can0 456#04\n", true);
+    QVERIFY(reader.resume());
+    QCOMPARE(reader.read(frames, 4), 2);
+    QCOMPARE(frames[0].id, quint32(0x123));
+    QCOMPARE(int(frames[0].length), 2);
+    QCOMPARE(int(frames[0].data[1]), 3);
+    QCOMPARE(frames[0].usec, quint32(2));
+    QCOMPARE(frames[1].id, quint32(0x456));
+
+    // nothing new, nothing read
+    QVERIFY(reader.resume());
+    QCOMPARE(reader.read(frames, 4), 0);
+}
+
+void TestCandumpReader::truncated()
+{
+    write(_log, "(1.000001) can0 123#01\n(1.000002) can0 123#02\n");
+    BusTable buses;
+    CandumpReader reader(&buses);
+    QVERIFY(reader.open(_log));
+    reader.setFollow(true);
+    CANFrame frames[4];
+    QCOMPARE(reader.read(frames, 4), 2);
+
+    write(_log, "(2.000001) can0 789#05\n");
+    QVERIFY(!reader.resume());
+    QVERIFY(reader.resume());
+    QCOMPARE(reader.read(frames, 4), 1);
+    QCOMPARE(frames[0].id, quint32(0x789));
+}
+
+void TestCandumpReader::followReplacedFile()
+{
+    write(_log, "(1.000001) can0 123#01\n");
+    LogModel model(nullptr);
+    LogFollower follower(&model);
+    QVERIFY(follower.start(_log));
+    QCOMPARE(model.rowCount(), 1);
+
+    // a sync tool deletes the file and renames a new copy in later
+    QVERIFY(QFile::remove(_log));
+    QTest::qWait(300);
+    QString temp = _dir.filePath("replace.tmp");
+    write(temp, "(1.000001) can0 123#01\n(1.000002) can0 456#02\n");
+    QVERIFY(QFile::rename(temp, _log));
+    QTRY_COMPARE(model.rowCount(), 2);
+
+    // and the new file is watched again
+    write(_log, "(1.000003) can0 789#03\n", true);
+    QTRY_COMPARE(model.rowCount(), 3);
+}
+
+QTEST_GUILESS_MAIN(TestCandumpReader)
+#include "tst_candumpreader.moc"
@@ -0,0 +1,10 @@
+include(../core.pri)
+
+TARGET = tst_cangen
+
+INCLUDEPATH += $$SRC/tools/cangen
+
+SOURCES += tst_cangen.cpp \
+    $$SRC/tools/cangen/generator.cpp
+
+HEADERS += $$SRC/tools/cangen/generator.h
@@ -0,0 +1,156 @@
+#include <QtTest>
+#include <cstring>
+#include "generator.h"
+
+// The generator's output must read back unchanged, logs made with it are
+// known answers for regression tests.
+class TestCangen : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip();
+    void sameSeed();
+    void eventOnNewId();
+    void eventPastFrame();
+    void badEvents();
+};
+
+void TestCangen::roundTrip()
+{
+    GeneratorConfig config;
+    config.ids = 300;
+    config.buses = 3;
+    config.extended = 0.5;
+    config.fd = 0.3;
+    config.changes = 0.2;
+    Generator gen(config);
+
+    const char *buses[] = { "can0", "can1", "can2" };
+    bool seenFd = false;
+    bool seenExtended = false;
+    char line[256];
+    for(int i = 0; i < 20000; i++)
+    {
+        CANFrame frame;
+        quint64 offset;
+        gen.next(frame, offset);
+        int len = Generator::formatCandump(frame, buses[frame.bus], 4, line);
+        QVERIFY(len < 200);
+        QCOMPARE(line[len - 1], '\n');
+
+        CANFrame parsed;
+        const char *bus;
+        int busLen;
+        QVERIFY2(parseCandumpLine(line, line + len, parsed, bus, busLen), line);
+        QCOMPARE(QByteArray(bus, busLen), QByteArray(buses[frame.bus]));
+        QCOMPARE(parsed.sec, frame.sec);
+        QCOMPARE(parsed.usec, frame.usec);
+        QCOMPARE(parsed.id, frame.id);
+        QCOMPARE(int(parsed.flags), int(frame.flags));
+        QCOMPARE(int(parsed.length), int(frame.length));
+        QVERIFY(memcmp(parsed.data, frame.data, frame.length) == 0);
+        seenFd |= (frame.flags & CANFrame::FD) && (frame.length > 8);
+        seenExtended |= (frame.flags & CANFrame::Extended);
+    }
+    QVERIFY(seenFd);
+    QVERIFY(seenExtended);
+}
+
+void TestCangen::sameSeed()
+{
+    GeneratorConfig config;
+    config.seed = 42;
+    Generator a(config);
+    Generator b(config);
+    for(int i = 0; i < 1000; i++)
+    {
+        CANFrame fa, fb;
+        quint64 oa, ob;
+        a.next(fa, oa);
+        b.next(fb, ob);
+        QCOMPARE(oa, ob);
+        QCOMPARE(fa.id, fb.id);
+        QVERIFY(memcmp(fa.data, fb.data, fa.length) == 0);
+    }
+}
+
+void TestCangen::eventOnNewId()
+{
+    GeneratorConfig config;
+    config.ids = 0;
+    GeneratorEvent ev;
+    QVERIFY(GeneratorEvent::parse("1,7e0,5,a5,2", ev));
+    config.events.append(ev);
+    QVERIFY(GeneratorEvent::parse("1,18daf110,20,5a,2", ev));
+    config.events.append(ev);
+    Generator gen(config);
+    QCOMPARE(gen.size(), 2);
+    QVERIFY(gen.unplacedEvents().isEmpty());
+
+    int hits[2] = { 0, 0 };
+    for(int i = 0; i < 2000; i++)
+    {
+        CANFrame frame;
+        quint64 offset;
+        gen.next(frame, offset);
+        bool active = (offset >= 1000000) && (offset < 3000000);
+        if(frame.id == 0x7e0)
+        {
+            QVERIFY(frame.length > 5);
+            if(active)
+            {
+                QCOMPARE(int(frame.data[5]), 0xa5);
+                hits[0]++;
+            }
+        }
+        else
+        {
+            QCOMPARE(frame.id, quint32(0x18daf110));
+            QVERIFY(frame.flags & CANFrame::FD);
+            QVERIFY(frame.length > 20);
+            if(active)
+            {
+                QCOMPARE(int(frame.data[20]), 0x5a);
+                hits[1]++;
+            }
+        }
+    }
+    QVERIFY(hits[0] > 0);
+    QVERIFY(hits[1] > 0);
+}
+
+void TestCangen::eventPastFrame()
+{
+    // a scripted ID that exists with classic frames cannot take byte 40
+    GeneratorConfig config;
+    config.ids = 0;
+    GeneratorEvent ev;
+    QVERIFY(GeneratorEvent::parse("0,123,1,01", ev));
+    config.events.append(ev);
+    QVERIFY(GeneratorEvent::parse("0,123,40,01", ev));
+    config.events.append(ev);
+    Generator gen(config);
+    QCOMPARE(gen.size(), 1);
+    QCOMPARE(gen.unplacedEvents(), QVector<int>({ 1 }));
+}
+
+void TestCangen::badEvents()
+{
+    GeneratorEvent ev;
+    QVERIFY(!GeneratorEvent::parse("-1,123,0,01", ev));
+    QVERIFY(!GeneratorEvent::parse("1,123,0,01,-2", ev));
+    QVERIFY(!GeneratorEvent::parse("nan,123,0,01", ev));
+    QVERIFY(!GeneratorEvent::parse("1e300,123,0,01", ev));
+    QVERIFY(!GeneratorEvent::parse("1,123,64,01", ev));
+    QVERIFY(!GeneratorEvent::parse("1,123,0,100", ev));
+    QVERIFY(!GeneratorEvent::parse("1,20000000,0,01", ev));
+    QVERIFY(GeneratorEvent::parse("1.5,123,7,ff,0.25", ev));
+    QCOMPARE(ev.time, quint64(1500000));
+    QCOMPARE(ev.duration, quint64(250000));
+    QCOMPARE(ev.byte, 7);
+    QCOMPARE(int(ev.value), 0xff);
+}
+
+QTEST_GUILESS_MAIN(TestCangen)
+#include "tst_cangen.moc"
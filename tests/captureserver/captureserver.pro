@@ -0,0 +1,7 @@
+include(../core.pri)
+
+TARGET = tst_captureserver
+
+SOURCES += tst_captureserver.cpp \
+    $$SRC/captureserver.cpp
+HEADERS += $$SRC/captureserver.h
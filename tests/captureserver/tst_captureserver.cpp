@@ -0,0 +1,180 @@
+#include <QtTest>
+#include <QLocalSocket>
+#include <QNetworkInterface>
+#include <QTcpSocket>
+#include "captureserver.h"
+#include "logmodel.h"
+
+// A server over a model fed by hand, clients read its updates off real sockets.
+class TestCaptureServer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void snapshotCapped();
+    void localhostByDefault();
+    void loopbackControl();
+    void remoteControl();
+
+private:
+    void feed(LogModel &model, int count);
+    static bool receive(QIODevice &socket, QByteArray &buffer, RemoteUpdate &update);
+    static QHostAddress otherAddress();
+
+    int _frames = 0;
+};
+
+// 0x100 on can0 with new data in every frame
+void TestCaptureServer::feed(LogModel &model, int count)
+{
+    QVector<CANFrame> frames(count);
+    quint16 bus = model.buses()->handle(QString("can0"));
+    for(CANFrame &frame : frames)
+    {
+        memset(&frame, 0, sizeof(frame));
+        frame.sec = 1000 + _frames / 1000;
+        frame.usec = (_frames % 1000) * 1000;
+        frame.bus = bus;
+        frame.length = 2;
+        frame.id = 0x100;
+        frame.data[0] = quint8(_frames >> 8);
+        frame.data[1] = quint8(_frames);
+        _frames++;
+    }
+    model.procFrames(frames.constData(), frames.size());
+}
+
+// the server runs on this thread, the event loop has to turn while waiting
+bool TestCaptureServer::receive(QIODevice &socket, QByteArray &buffer, RemoteUpdate &update)
+{
+    QByteArray payload;
+    QElapsedTimer timer;
+    timer.start();
+    while(!RemoteProtocol::takeMessage(buffer, payload))
+    {
+        if(timer.elapsed() > 5000) return false;
+        QTest::qWait(10);
+        buffer.append(socket.readAll());
+    }
+    return RemoteProtocol::decodeUpdate(payload, update);
+}
+
+QHostAddress TestCaptureServer::otherAddress()
+{
+    for(const QHostAddress &address : QNetworkInterface::allAddresses())
+    {
+        if((address.protocol() == QAbstractSocket::IPv4Protocol) && !address.isLoopback()) return address;
+    }
+    return QHostAddress();
+}
+
+void TestCaptureServer::snapshotCapped()
+{
+    LogModel model(nullptr);
+    model.setLogChange(true);
+    feed(model, 1000);
+    quint32 count = model.message(0).changeLog.size();
+    QVERIFY(count > 256);
+
+    CaptureServer server(&model);
+    server.setInterval(10);
+    QString name = QString("tst_captureserver_%1").arg(QCoreApplication::applicationPid());
+    QVERIFY(server.listen(name));
+    QCOMPARE(server.serverPort(), quint16(0));
+    QLocalSocket socket;
+    socket.connectToServer(name);
+    QVERIFY(socket.waitForConnected(5000));
+
+    // a resync carries the tail of the log only
+    QByteArray buffer;
+    RemoteUpdate snapshot;
+    QVERIFY(receive(socket, buffer, snapshot));
+    QVERIFY(snapshot.snapshot);
+    QCOMPARE(snapshot.rows.size(), 1);
+    QCOMPARE(snapshot.rows[0].changeBase, count - 256);
+    QCOMPARE(snapshot.rows[0].changes.size(), 256);
+    QCOMPARE(snapshot.rows[0].changes.last().data, model.message(0).changeLog.last().data);
+
+    // and later changes follow it by the server's count
+    feed(model, 10);
+    RemoteUpdate delta;
+    do
+    {
+        QVERIFY(receive(socket, buffer, delta));
+    }
+    while(delta.rows.isEmpty());
+    QVERIFY(!delta.snapshot);
+    QCOMPARE(delta.rows[0].changeBase, count);
+    QCOMPARE(quint32(delta.rows[0].changes.size()), quint32(model.message(0).changeLog.size()) - count);
+
+    LogModel client(nullptr);
+    client.applyRemote(snapshot);
+    client.applyRemote(delta);
+    QCOMPARE(client.message(0).changeLog.size(), 256 + delta.rows[0].changes.size());
+    QCOMPARE(client.message(0).changes.times(), model.message(0).changes.times().mid(count - 256));
+}
+
+void TestCaptureServer::localhostByDefault()
+{
+    LogModel model(nullptr);
+    CaptureServer server(&model);
+    QVERIFY(server.listen(":0"));
+    QVERIFY(server.serverPort() != 0);
+
+    QTcpSocket local;
+    local.connectToHost(QHostAddress(QHostAddress::LocalHost), server.serverPort());
+    QVERIFY(local.waitForConnected(5000));
+
+    QHostAddress other = otherAddress();
+    if(other.isNull()) QSKIP("No address besides loopback");
+    QTcpSocket remote;
+    remote.connectToHost(other, server.serverPort());
+    QVERIFY(!remote.waitForConnected(5000));
+}
+
+void TestCaptureServer::loopbackControl()
+{
+    LogModel model(nullptr);
+    model.setLogChange(true);
+    feed(model, 10);
+    CaptureServer server(&model);
+    QVERIFY(server.listen("127.0.0.1:0"));
+
+    QTcpSocket socket;
+    socket.connectToHost(QHostAddress(QHostAddress::LocalHost), server.serverPort());
+    QVERIFY(socket.waitForConnected(5000));
+    socket.write(RemoteProtocol::encodeCommand(RemoteProtocol::ClearChanges));
+    QTRY_VERIFY(model.message(0).changeLog.isEmpty());
+}
+
+void TestCaptureServer::remoteControl()
+{
+    QHostAddress other = otherAddress();
+    if(other.isNull()) QSKIP("No address besides loopback");
+
+    LogModel model(nullptr);
+    model.setLogChange(true);
+    feed(model, 10);
+    CaptureServer server(&model);
+    QVERIFY(server.listen(other.toString() + ":0"));
+
+    // watching only, the command is dropped with a warning
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("^Ignoring commands from "));
+    QTcpSocket watcher;
+    watcher.connectToHost(other, server.serverPort());
+    QVERIFY(watcher.waitForConnected(5000));
+    watcher.write(RemoteProtocol::encodeCommand(RemoteProtocol::ClearChanges));
+    QTest::qWait(200);
+    QVERIFY(!model.message(0).changeLog.isEmpty());
+
+    // clients connected once it is allowed may control the server
+    server.setRemoteControl(true);
+    QTcpSocket controller;
+    controller.connectToHost(other, server.serverPort());
+    QVERIFY(controller.waitForConnected(5000));
+    controller.write(RemoteProtocol::encodeCommand(RemoteProtocol::ClearChanges));
+    QTRY_VERIFY(model.message(0).changeLog.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestCaptureServer)
+#include "tst_captureserver.moc"
@@ -0,0 +1,5 @@
+include(../core.pri)
+
+TARGET = tst_changeindex
+
+SOURCES += tst_changeindex.cpp
@@ -0,0 +1,104 @@
+#include <QtTest>
+#include <algorithm>
+#include "changeindex.h"
+
+class TestChangeIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void ranges_data();
+    void ranges();
+    void arrivalOrder();
+    void clear();
+};
+
+void TestChangeIndex::ranges_data()
+{
+    QTest::addColumn<int>("backwards");
+
+    QTest::newRow("ordered") << 0;
+    QTest::newRow("some late") << 5;
+    QTest::newRow("mostly late") << 2;
+}
+
+// every range against a plain scan, late entries must not change the answers
+void TestChangeIndex::ranges()
+{
+    QFETCH(int, backwards);
+
+    ChangeIndex index;
+    QVector<quint64> times;
+    QVector<quint64> deltas;
+    quint64 state = 12345;
+    auto next = [&state]()
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+    quint64 ts = 1000;
+    for(int i = 0; i < 500; i++)
+    {
+        quint64 t = (backwards && ((next() % backwards) == 0)) ? (ts - next() % 800) : (ts += next() % 20);
+        quint64 delta = quint64(1) << (next() % 64);
+        index.append(t, delta);
+        times.append(t);
+        deltas.append(delta);
+    }
+    QCOMPARE(index.ordered(), backwards == 0);
+
+    for(int q = 0; q < 1000; q++)
+    {
+        quint64 from = next() % (ts + 100);
+        quint64 to = from + next() % 2000;
+        quint64 expected = 0;
+        for(int i = 0; i < times.size(); i++)
+        {
+            if((times[i] >= from) && (times[i] < to)) expected |= deltas[i];
+        }
+        QCOMPARE(index.bits(from, to), expected);
+    }
+
+    const QVector<quint64> &sorted = index.sortedTimes();
+    QVERIFY(std::is_sorted(sorted.constBegin(), sorted.constEnd()));
+}
+
+void TestChangeIndex::arrivalOrder()
+{
+    ChangeIndex index;
+    index.append(100, 0x1);
+    index.append(300, 0x2);
+    index.append(200, 0x4);
+    index.append(200, 0x8);
+    index.append(400, 0x10);
+
+    QCOMPARE(index.times(), QVector<quint64>({ 100, 300, 200, 200, 400 }));
+    QCOMPARE(index.deltas(), QVector<quint64>({ 0x1, 0x2, 0x4, 0x8, 0x10 }));
+    // equal times stay in arrival order
+    QCOMPARE(index.sortedTimes(), QVector<quint64>({ 100, 200, 200, 300, 400 }));
+    QCOMPARE(index.sortedDeltas(), QVector<quint64>({ 0x1, 0x4, 0x8, 0x2, 0x10 }));
+    QCOMPARE(index.bits(150, 250), quint64(0xc));
+    QCOMPARE(index.bits(200, 301), quint64(0xe));
+}
+
+void TestChangeIndex::clear()
+{
+    ChangeIndex index;
+    index.append(200, 0x1);
+    index.append(100, 0x2);
+    QVERIFY(!index.ordered());
+
+    index.clear();
+    QVERIFY(index.ordered());
+    QCOMPARE(index.size(), 0);
+    QCOMPARE(index.bits(0, 1000), quint64(0));
+
+    index.append(50, 0x4);
+    QCOMPARE(index.times(), QVector<quint64>({ 50 }));
+    QCOMPARE(index.bits(0, 1000), quint64(0x4));
+}
+
+QTEST_GUILESS_MAIN(TestChangeIndex)
+#include "tst_changeindex.moc"
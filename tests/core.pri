@@ -0,0 +1,47 @@
+# Model and reader sources shared by the unit tests, everything but the main window.
+
+QT       += core gui widgets serialbus concurrent network testlib
+
+CONFIG += console c++14 testcase
+CONFIG -= app_bundle
+
+LIBS += -lz
+
+SRC = $$PWD/..
+INCLUDEPATH += $$SRC
+
+SOURCES += $$SRC/logmodel.cpp \
+    $$SRC/logdialog.cpp \
+    $$SRC/pipelinestats.cpp \
+    $$SRC/tracer.cpp \
+    $$SRC/canframe.cpp \
+    $$SRC/framereader.cpp \
+    $$SRC/logfollower.cpp \
+    $$SRC/pcapreader.cpp \
+    $$SRC/blfreader.cpp \
+    $$SRC/journal.cpp \
+    $$SRC/correlator.cpp \
+    $$SRC/signaldetector.cpp \
+    $$SRC/changeindex.cpp \
+    $$SRC/mergedreader.cpp \
+    $$SRC/remoteprotocol.cpp \
+    $$SRC/sidecarindex.cpp
+
+HEADERS += $$SRC/logmodel.h \
+    $$SRC/logdialog.h \
+    $$SRC/pipelinestats.h \
+    $$SRC/tracer.h \
+    $$SRC/canframe.h \
+    $$SRC/framereader.h \
+    $$SRC/logfollower.h \
+    $$SRC/pcapreader.h \
+    $$SRC/blfreader.h \
+    $$SRC/journal.h \
+    $$SRC/correlator.h \
+    $$SRC/signaldetector.h \
+    $$SRC/changeindex.h \
+    $$SRC/mergedreader.h \
+    $$SRC/remoteprotocol.h \
+    $$SRC/sidecarindex.h
+
+FORMS += $$SRC/logdialog.ui
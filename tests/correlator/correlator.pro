@@ -0,0 +1,5 @@
+include(../core.pri)
+
+TARGET = tst_correlator
+
+SOURCES += tst_correlator.cpp
@@ -0,0 +1,103 @@
+#include <QtTest>
+#include <algorithm>
+#include "correlator.h"
+#include "logmodel.h"
+
+// One ID over 110 s with a marker every 10 s: bit 0 toggles 50 ms before
+// each marker, bit 8 100 ms after it and bit 16 every second.
+class TestCorrelator : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void afterOnly();
+    void beforeAndAfter();
+    void overlapping();
+
+private:
+    static const CorrelationCandidate *find(const QVector<CorrelationCandidate> &res, int bit);
+
+    CANMessage _msg;
+    QVector<quint64> _markers;
+};
+
+const quint64 second = 1000000;
+const quint64 end = 110 * second;
+
+void TestCorrelator::initTestCase()
+{
+    QVector<QPair<quint64, quint64>> changes;
+    for(quint64 t = 10 * second; t <= 100 * second; t += 10 * second)
+    {
+        _markers.append(t);
+        changes.append(qMakePair(t - 50000, quint64(0x01)));
+        changes.append(qMakePair(t + 100000, quint64(0x100)));
+    }
+    for(quint64 t = second; t < end; t += second) changes.append(qMakePair(t, quint64(0x10000)));
+    std::sort(changes.begin(), changes.end());
+
+    _msg.can = "can0";
+    _msg.id = 0x100;
+    _msg.length = 8;
+    for(const QPair<quint64, quint64> &change : changes) _msg.changes.append(change.first, change.second);
+}
+
+const CorrelationCandidate *TestCorrelator::find(const QVector<CorrelationCandidate> &res, int bit)
+{
+    for(const CorrelationCandidate &c : res)
+    {
+        if(c.bit == bit) return &c;
+    }
+    return nullptr;
+}
+
+void TestCorrelator::afterOnly()
+{
+    Correlator correlator(_markers, 0, 500000, 0, end);
+    QVector<CorrelationCandidate> res = correlator.run({ &_msg });
+    QVERIFY(!find(res, 0));
+    QVERIFY(find(res, 8));
+    QCOMPARE(find(res, 8)->hits, 10);
+    QCOMPARE(find(res, 8)->markers, 10);
+    QCOMPARE(res.first().bit, 8);
+
+    // the second tick falls into every window, its baseline is high
+    const CorrelationCandidate *noise = find(res, 16);
+    QVERIFY(noise);
+    QCOMPARE(noise->hits, 10);
+    QVERIFY(noise->baseline > 0.3);
+    QVERIFY(noise->score < find(res, 8)->score);
+}
+
+void TestCorrelator::beforeAndAfter()
+{
+    // a marker pressed late still finds the toggle that came first
+    Correlator correlator(_markers, 100000, 500000, 0, end);
+    QVector<CorrelationCandidate> res = correlator.run({ &_msg });
+    QVERIFY(find(res, 0));
+    QCOMPARE(find(res, 0)->hits, 10);
+    QVERIFY(find(res, 0)->baseline < 0.01);
+    QCOMPARE(find(res, 8)->hits, 10);
+
+    // too short a window before the marker misses it
+    Correlator late(_markers, 40000, 500000, 0, end);
+    QVERIFY(!find(late.run({ &_msg }), 0));
+}
+
+void TestCorrelator::overlapping()
+{
+    // windows longer than the marker spacing join up, the toggles next to
+    // the markers are never outside them
+    Correlator correlator(_markers, 6 * second, 6 * second, 0, end);
+    QVector<CorrelationCandidate> res = correlator.run({ &_msg });
+    for(int bit : { 0, 8 })
+    {
+        QVERIFY(find(res, bit));
+        QCOMPARE(find(res, bit)->hits, 10);
+        QVERIFY(find(res, bit)->baseline == 0.0);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestCorrelator)
+#include "tst_correlator.moc"
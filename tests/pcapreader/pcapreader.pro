@@ -0,0 +1,5 @@
+include(../core.pri)
+
+TARGET = tst_pcapreader
+
+SOURCES += tst_pcapreader.cpp
@@ -0,0 +1,84 @@
+#include <QtTest>
+#include <QtEndian>
+#include <QTemporaryFile>
+#include "pcapreader.h"
+
+// Captures are assembled in memory, one record per SocketCAN frame type.
+class TestPcapReader : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void skipsCanXl();
+
+private:
+    static void appendU32(QByteArray &out, quint32 value);
+    static void appendRecord(QByteArray &out, quint32 sec, quint32 usec, const QByteArray &data);
+};
+
+void TestPcapReader::appendU32(QByteArray &out, quint32 value)
+{
+    uchar buf[4];
+    qToLittleEndian(value, buf);
+    out.append(reinterpret_cast<const char *>(buf), 4);
+}
+
+void TestPcapReader::appendRecord(QByteArray &out, quint32 sec, quint32 usec, const QByteArray &data)
+{
+    appendU32(out, sec);
+    appendU32(out, usec);
+    appendU32(out, data.size());
+    appendU32(out, data.size());
+    out.append(data);
+}
+
+void TestPcapReader::skipsCanXl()
+{
+    QByteArray pcap;
+    appendU32(pcap, 0xa1b2c3d4);
+    appendU32(pcap, 0x00040002);    // version 2.4
+    appendU32(pcap, 0);
+    appendU32(pcap, 0);
+    appendU32(pcap, 65535);
+    appendU32(pcap, 227);           // LINKTYPE_CAN_SOCKETCAN
+
+    // classic: id, length, FD flags, reserved, data
+    appendRecord(pcap, 10, 1, QByteArray::fromHex("0000012302000000" "beef"));
+
+    // XL: priority, CANXL_XLF flags, SDT, length, acceptance field, data;
+    // the SDT byte sits where FD frames keep their flags
+    QByteArray xl = QByteArray::fromHex("00000089" "80" "03" "4000" "00000000");
+    xl.append(QByteArray(64, '\x55'));
+    appendRecord(pcap, 10, 2, xl);
+
+    // FD with an extended id
+    QByteArray fd = QByteArray::fromHex("80000456" "0c" "04" "0000");
+    fd.append(QByteArray::fromHex("0102030405060708090a0b0c"));
+    appendRecord(pcap, 10, 3, fd);
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.write(pcap);
+    file.close();
+
+    BusTable buses;
+    PcapReader reader(&buses);
+    QVERIFY(reader.open(file.fileName()));
+    CANFrame frames[4];
+    QCOMPARE(reader.read(frames, 4), 2);
+
+    QCOMPARE(frames[0].id, quint32(0x123));
+    QCOMPARE(int(frames[0].flags), 0);
+    QCOMPARE(int(frames[0].length), 2);
+    QCOMPARE(frames[0].payload(), quint64(0xbeef));
+    QCOMPARE(frames[0].usec, quint32(1));
+
+    QCOMPARE(frames[1].id, quint32(0x456));
+    QCOMPARE(int(frames[1].flags), int(CANFrame::Extended | CANFrame::FD));
+    QCOMPARE(int(frames[1].length), 12);
+    QCOMPARE(int(frames[1].data[11]), 0x0c);
+    QCOMPARE(frames[1].usec, quint32(3));
+}
+
+QTEST_GUILESS_MAIN(TestPcapReader)
+#include "tst_pcapreader.moc"
@@ -0,0 +1,5 @@
+include(../core.pri)
+
+TARGET = tst_remoteprotocol
+
+SOURCES += tst_remoteprotocol.cpp
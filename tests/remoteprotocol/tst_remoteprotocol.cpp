@@ -0,0 +1,164 @@
+#include <QtTest>
+#include "remoteprotocol.h"
+
+// Messages go through the same framing the sockets use.
+class TestRemoteProtocol : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void snapshot();
+    void delta();
+    void command();
+    void wrongType();
+    void partialMessage();
+
+private:
+    static RemoteUpdate roundTrip(const RemoteUpdate &update);
+};
+
+RemoteUpdate TestRemoteProtocol::roundTrip(const RemoteUpdate &update)
+{
+    QByteArray buffer = RemoteProtocol::encodeUpdate(update);
+    QByteArray payload;
+    RemoteUpdate res;
+    if(!RemoteProtocol::takeMessage(buffer, payload)) return res;
+    if(!buffer.isEmpty()) return res;
+    if(!RemoteProtocol::decodeUpdate(payload, res)) return RemoteUpdate();
+    return res;
+}
+
+void TestRemoteProtocol::snapshot()
+{
+    RemoteUpdate update;
+    update.snapshot = true;
+    update.generation = 7;
+    update.firstTimestamp = 1500000000000000ull;
+    update.lastTimestamp = 1500000001000000ull;
+    update.stats = "1000 frames";
+    RemoteRow row;
+    row.can = "can0";
+    row.id = 0x18daf110;
+    row.length = 8;
+    row.status = 2;
+    row.data = 0x0102030405060708ull;
+    row.bitmask = 0xff00;
+    row.chbits = 0x0f;
+    row.known = 0xffffffffffffffffull;
+    update.rows.append(row);
+    row.can = "can1";
+    row.id = 0x123;
+    update.rows.append(row);
+
+    RemoteUpdate res = roundTrip(update);
+    QVERIFY(res.snapshot);
+    QCOMPARE(res.generation, quint32(7));
+    QCOMPARE(res.firstTimestamp, update.firstTimestamp);
+    QCOMPARE(res.lastTimestamp, update.lastTimestamp);
+    QCOMPARE(res.stats, update.stats);
+    QCOMPARE(res.rows.size(), 2);
+    QCOMPARE(res.rows[0].can, QString("can0"));
+    QCOMPARE(res.rows[0].id, quint32(0x18daf110));
+    QCOMPARE(int(res.rows[0].length), 8);
+    QCOMPARE(int(res.rows[0].status), 2);
+    QCOMPARE(res.rows[0].data, row.data);
+    QCOMPARE(res.rows[0].bitmask, row.bitmask);
+    QCOMPARE(res.rows[0].chbits, row.chbits);
+    QCOMPARE(res.rows[0].known, row.known);
+    QCOMPARE(res.rows[0].changeBase, quint32(0));
+    QVERIFY(res.rows[0].changes.isEmpty());
+    QCOMPARE(res.rows[1].can, QString("can1"));
+    QCOMPARE(res.rows[1].id, quint32(0x123));
+}
+
+void TestRemoteProtocol::delta()
+{
+    RemoteUpdate update;
+    update.generation = 3;
+    RemoteRow row;
+    row.can = "can0";
+    row.id = 0x7e8;
+    row.changeBase = 41;
+    RemoteChange change;
+    change.sec = 10;
+    change.usec = 999999;
+    change.data = 0x1122;
+    change.delta = 0x0100;
+    row.changes.append(change);
+    change.usec = 5;
+    change.delta = 0;
+    row.changes.append(change);
+    update.rows.append(row);
+
+    RemoteUpdate res = roundTrip(update);
+    QVERIFY(!res.snapshot);
+    QCOMPARE(res.generation, quint32(3));
+    QCOMPARE(res.rows.size(), 1);
+    QCOMPARE(res.rows[0].changeBase, quint32(41));
+    QCOMPARE(res.rows[0].changes.size(), 2);
+    QCOMPARE(res.rows[0].changes[0].sec, quint64(10));
+    QCOMPARE(res.rows[0].changes[0].usec, quint32(999999));
+    QCOMPARE(res.rows[0].changes[0].data, quint64(0x1122));
+    QCOMPARE(res.rows[0].changes[0].delta, quint64(0x0100));
+    QCOMPARE(res.rows[0].changes[1].usec, quint32(5));
+    QCOMPARE(res.rows[0].changes[1].delta, quint64(0));
+}
+
+void TestRemoteProtocol::command()
+{
+    QByteArray buffer = RemoteProtocol::encodeCommand(RemoteProtocol::SetFiltering, true);
+    buffer += RemoteProtocol::encodeCommand(RemoteProtocol::ClearChanges);
+
+    QByteArray payload;
+    RemoteProtocol::CommandType command;
+    bool value;
+    QVERIFY(RemoteProtocol::takeMessage(buffer, payload));
+    QVERIFY(RemoteProtocol::decodeCommand(payload, command, value));
+    QCOMPARE(int(command), int(RemoteProtocol::SetFiltering));
+    QVERIFY(value);
+
+    QVERIFY(RemoteProtocol::takeMessage(buffer, payload));
+    QVERIFY(RemoteProtocol::decodeCommand(payload, command, value));
+    QCOMPARE(int(command), int(RemoteProtocol::ClearChanges));
+    QVERIFY(!value);
+    QVERIFY(buffer.isEmpty());
+}
+
+void TestRemoteProtocol::wrongType()
+{
+    QByteArray buffer = RemoteProtocol::encodeCommand(RemoteProtocol::ClearStatus);
+    QByteArray payload;
+    QVERIFY(RemoteProtocol::takeMessage(buffer, payload));
+    RemoteUpdate update;
+    QVERIFY(!RemoteProtocol::decodeUpdate(payload, update));
+
+    buffer = RemoteProtocol::encodeUpdate(RemoteUpdate());
+    QVERIFY(RemoteProtocol::takeMessage(buffer, payload));
+    RemoteProtocol::CommandType command;
+    bool value;
+    QVERIFY(!RemoteProtocol::decodeCommand(payload, command, value));
+
+    // truncated rows
+    RemoteUpdate full;
+    full.rows.resize(3);
+    buffer = RemoteProtocol::encodeUpdate(full);
+    QVERIFY(RemoteProtocol::takeMessage(buffer, payload));
+    payload.chop(5);
+    QVERIFY(!RemoteProtocol::decodeUpdate(payload, update));
+}
+
+void TestRemoteProtocol::partialMessage()
+{
+    QByteArray message = RemoteProtocol::encodeCommand(RemoteProtocol::SetGenMask, true);
+    QByteArray buffer = message.left(message.size() - 1);
+    QByteArray payload;
+    QVERIFY(!RemoteProtocol::takeMessage(buffer, payload));
+    QCOMPARE(buffer.size(), message.size() - 1);
+
+    buffer.append(message.right(1));
+    QVERIFY(RemoteProtocol::takeMessage(buffer, payload));
+    QVERIFY(buffer.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestRemoteProtocol)
+#include "tst_remoteprotocol.moc"
@@ -0,0 +1,10 @@
+include(../core.pri)
+
+TARGET = tst_sharding
+
+INCLUDEPATH += $$SRC/tools/cangen
+
+SOURCES += tst_sharding.cpp \
+    $$SRC/tools/cangen/generator.cpp
+
+HEADERS += $$SRC/tools/cangen/generator.h
@@ -0,0 +1,113 @@
+#include <QtTest>
+#include "generator.h"
+#include "logmodel.h"
+
+// Frames processed across shards on worker threads must leave the model as
+// one thread does: the same rows in the same order, and every ID's frames
+// applied in their order, which its change log records.
+class TestSharding : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void sameAsOneThread_data();
+    void sameAsOneThread();
+
+private:
+    QVector<CANFrame> _frames;
+};
+
+void TestSharding::initTestCase()
+{
+    GeneratorConfig config;
+    config.ids = 400;
+    config.buses = 3;
+    config.extended = 0.3;
+    config.fd = 0.1;
+    config.changes = 0.05;
+    config.periodMin = 10000;
+    config.periodMax = 100000;
+    Generator gen(config);
+
+    _frames.resize(100000);
+    for(CANFrame &frame : _frames)
+    {
+        quint64 offset;
+        gen.next(frame, offset);
+    }
+}
+
+void TestSharding::sameAsOneThread_data()
+{
+    QTest::addColumn<bool>("genMask");
+    QTest::addColumn<int>("batch");
+
+    // full batches run on the workers, small ones on the calling thread
+    QTest::newRow("changes, large batches") << false << 4096;
+    QTest::newRow("changes, small batches") << false << 100;
+    QTest::newRow("masks, large batches") << true << 4096;
+}
+
+void TestSharding::sameAsOneThread()
+{
+    QFETCH(bool, genMask);
+    QFETCH(int, batch);
+
+    LogModel single(nullptr);
+    LogModel sharded(nullptr);
+    single.setThreads(1);
+    sharded.setThreads(4);
+    QCOMPARE(single.threads(), 1);
+    QCOMPARE(sharded.threads(), 4);
+    for(LogModel *model : { &single, &sharded })
+    {
+        for(const char *bus : { "can0", "can1", "can2" }) model->buses()->handle(QString(bus));
+        if(genMask) model->setGenMask(true);
+        else model->setLogChange(true);
+        for(int i = 0; i < _frames.size(); i += batch)
+        {
+            model->procFrames(_frames.constData() + i, qMin(batch, _frames.size() - i));
+        }
+    }
+
+    QCOMPARE(sharded.rowCount(), single.rowCount());
+    QVERIFY(single.rowCount() > 300);
+    int logged = 0;
+    for(int i = 0; i < single.rowCount(); i++)
+    {
+        const CANMessage &a = single.message(i);
+        const CANMessage &b = sharded.message(i);
+        QCOMPARE(b.can, a.can);
+        QCOMPARE(b.id, a.id);
+        QCOMPARE(b.status, a.status);
+        QCOMPARE(b.length, a.length);
+        QCOMPARE(b.data, a.data);
+        QCOMPARE(b.bitmask, a.bitmask);
+        QCOMPARE(b.chbits, a.chbits);
+        QCOMPARE(b.known, a.known);
+        QCOMPARE(b.detector.describe(), a.detector.describe());
+
+        QCOMPARE(b.changeLog.size(), a.changeLog.size());
+        QLinkedList<MessageLog>::const_iterator it = b.changeLog.constBegin();
+        quint64 last = 0;
+        for(const MessageLog &log : a.changeLog)
+        {
+            QCOMPARE(it->sec, log.sec);
+            QCOMPARE(it->usec, log.usec);
+            QCOMPARE(it->data, log.data);
+            // the generator's frames are in time order, so are an ID's changes
+            quint64 ts = log.sec * 1000000 + log.usec;
+            QVERIFY(ts >= last);
+            last = ts;
+            ++it;
+        }
+        QCOMPARE(b.changes.times(), a.changes.times());
+        QCOMPARE(b.changes.deltas(), a.changes.deltas());
+        logged += a.changeLog.size();
+    }
+    QCOMPARE(logged > 0, !genMask);
+}
+
+QTEST_GUILESS_MAIN(TestSharding)
+#include "tst_sharding.moc"
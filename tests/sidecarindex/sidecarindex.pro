@@ -0,0 +1,5 @@
+include(../core.pri)
+
+TARGET = tst_sidecarindex
+
+SOURCES += tst_sidecarindex.cpp
@@ -0,0 +1,300 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include "journal.h"
+#include "logmodel.h"
+#include "sidecarindex.h"
+
+// A small candump log is indexed on the first load and restored on the next.
+// A bigger one spans several batches, with a checkpoint after each of them.
+class TestSidecarIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void reopen();
+    void seek();
+    void clearDropsIndex();
+    void staleIndex();
+    void checkpoints();
+    void otherSettings();
+    void relog();
+
+private:
+    void load(LogModel &model, const QString &log);
+    static void compare(const LogModel &a, const LogModel &b);
+    static int rowOf(const LogModel &model, quint32 id);
+
+    QTemporaryDir _dir;
+    QString _log;
+    QString _bigLog;
+};
+
+void TestSidecarIndex::initTestCase()
+{
+    QVERIFY(_dir.isValid());
+    _log = _dir.filePath("test.log");
+    QFile file(_log);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    // a counter in byte 0 of 0x100, a value toggling in 0x200
+    for(int i = 0; i < 40; i++)
+    {
+        file.write(QString("(1000.%1) can0 100#%2%3\n").arg(i * 1000 + 1000, 6, 10, QChar('0'))
+                   .arg(i % 256, 2, 16, QChar('0')).arg((i / 8) % 2 ? "ff" : "00").toLatin1());
+        file.write(QString("(1000.%1) can1 200#%2\n").arg(i * 1000 + 1500, 6, 10, QChar('0'))
+                   .arg((i / 3) % 2 ? "0102" : "0304").toLatin1());
+    }
+    file.close();
+    QFile::remove(SidecarIndex::path(_log));
+
+    // five and a bit batches of 16384 frames, one per millisecond,
+    // 0x300 only shows up in the third batch
+    _bigLog = _dir.filePath("big.log");
+    QFile big(_bigLog);
+    QVERIFY(big.open(QIODevice::WriteOnly));
+    for(int i = 0; i < (5 * 16384 + 100); i++)
+    {
+        QString time = QString("(%1.%2)").arg(1000 + i / 1000).arg((i % 1000) * 1000, 6, 10, QChar('0'));
+        if((i >= 40000) && (i < 40100) && ((i % 10) == 5))
+            big.write(QString("%1 can0 300#%2\n").arg(time).arg((i / 10) % 2 ? "11" : "22").toLatin1());
+        else if(i % 2)
+            big.write(QString("%1 can1 200#%2\n").arg(time).arg((i / 6) % 2 ? "0102" : "0304").toLatin1());
+        else
+            big.write(QString("%1 can0 100#%2%3\n").arg(time).arg((i / 2) % 256, 2, 16, QChar('0'))
+                      .arg((i / 20) % 2 ? "ff" : "00").toLatin1());
+    }
+    big.close();
+    QFile::remove(SidecarIndex::path(_bigLog));
+}
+
+void TestSidecarIndex::load(LogModel &model, const QString &log)
+{
+    model.setUseIndex(true);
+    model.setLogChange(true);
+    model.loadLogs(QStringList(log));
+}
+
+void TestSidecarIndex::compare(const LogModel &a, const LogModel &b)
+{
+    QCOMPARE(b.rowCount(), a.rowCount());
+    QCOMPARE(b.lastTimestamp(), a.lastTimestamp());
+    for(int i = 0; i < a.rowCount(); i++)
+    {
+        const CANMessage &x = a.message(i);
+        const CANMessage &y = b.message(i);
+        QCOMPARE(y.can, x.can);
+        QCOMPARE(y.id, x.id);
+        QCOMPARE(y.data, x.data);
+        QCOMPARE(y.bitmask, x.bitmask);
+        QCOMPARE(y.chbits, x.chbits);
+        QCOMPARE(y.known, x.known);
+        QCOMPARE(y.detector.known(), x.detector.known());
+        QCOMPARE(y.detector.describe(), x.detector.describe());
+        QCOMPARE(y.changeLog.size(), x.changeLog.size());
+        QCOMPARE(y.changes.times(), x.changes.times());
+        QCOMPARE(y.changes.deltas(), x.changes.deltas());
+    }
+}
+
+int TestSidecarIndex::rowOf(const LogModel &model, quint32 id)
+{
+    for(int i = 0; i < model.rowCount(); i++)
+    {
+        if(model.message(i).id == id) return i;
+    }
+    return -1;
+}
+
+void TestSidecarIndex::reopen()
+{
+    LogModel parsed(nullptr);
+    load(parsed, _log);
+    QVERIFY(QFile::exists(SidecarIndex::path(_log)));
+    QVERIFY(parsed.canSeek());
+    for(int i = 0; i < parsed.rowCount(); i++) QVERIFY(!parsed.message(i).changeLog.isEmpty());
+
+    LogModel restored(nullptr);
+    load(restored, _log);
+    QVERIFY(restored.canSeek());
+    QCOMPARE(restored.rowCount(), 2);
+    compare(parsed, restored);
+}
+
+void TestSidecarIndex::seek()
+{
+    LogModel model(nullptr);
+    load(model, _log);
+    QVERIFY(model.canSeek());
+
+    // frames before 1000.020000, 0x100 has counted up to 18
+    QVERIFY(model.seekTo(1000020000ull));
+    QVERIFY(model.canSeek());
+    QCOMPARE(model.rowCount(), 2);
+    int row = (model.message(0).id == 0x100) ? 0 : 1;
+    const CANMessage &msg = model.message(row);
+    QCOMPARE(msg.id, quint32(0x100));
+    QCOMPARE(quint32(msg.data >> 8), quint32(18));
+    QVERIFY(msg.changes.times().last() < 1000020000ull);
+
+    // and forward again to the end
+    QVERIFY(model.seekTo(2000000000ull));
+    QCOMPARE(quint32(model.message(row).data >> 8), quint32(39));
+}
+
+void TestSidecarIndex::clearDropsIndex()
+{
+    LogModel model(nullptr);
+    load(model, _log);
+    QVERIFY(model.canSeek());
+    model.clearAll();
+    QVERIFY(!model.canSeek());
+    QVERIFY(!model.seekTo(1000020000ull));
+}
+
+void TestSidecarIndex::staleIndex()
+{
+    QString copy = _dir.filePath("copy.log");
+    QVERIFY(QFile::copy(_log, copy));
+    QVERIFY(QFile::copy(SidecarIndex::path(_log), SidecarIndex::path(copy)));
+    QFile file(copy);
+    QVERIFY(file.open(QIODevice::Append));
+    file.write("(1001.000000) can0 300#01\n");
+    file.close();
+
+    SidecarIndex index;
+    QVERIFY(!index.open(copy));
+}
+
+void TestSidecarIndex::checkpoints()
+{
+    LogModel full(nullptr);
+    full.setLogChange(true);
+    full.loadLogs(QStringList(_bigLog));
+
+    // a checkpoint after every batch, the changes are cleared right after
+    // the second one
+    const int cleared = 1;
+    QVector<quint64> times;
+    LogModel parsed(nullptr);
+    parsed.setIndexInterval(1);
+    connect(&parsed, &LogModel::progressValue, this, [&](int)
+    {
+        times.append(parsed.lastTimestamp());
+        if(times.size() == (cleared + 1)) parsed.clearChanges();
+    });
+    load(parsed, _bigLog);
+    disconnect(&parsed, &LogModel::progressValue, this, nullptr);
+    QVERIFY(parsed.canSeek());
+    QCOMPARE(times.size(), 6);
+
+    SidecarIndex index;
+    QVERIFY(index.open(_bigLog));
+    QCOMPARE(index.checkpoints(), times.size() + 1);
+
+    LogModel restored(nullptr);
+    load(restored, _bigLog);
+    QVERIFY(restored.canSeek());
+    compare(parsed, restored);
+    QVERIFY(restored.message(rowOf(restored, 0x100)).changes.times().first() > times[cleared]);
+
+    // into every checkpoint interval; up to the checkpoint after the clear
+    // the restored state still has the changes from before it
+    QVector<quint64> targets;
+    targets.append(times.first() / 2 + 1000000000ull / 2);
+    for(int k = 0; (k + 1) < times.size(); k++) targets.append((times[k] + times[k + 1]) / 2);
+    for(quint64 ts : targets)
+    {
+        QVERIFY(restored.seekTo(ts));
+        bool afterClear = (index.nearest(ts) > cleared);
+        for(quint32 id : { 0x100u, 0x200u })
+        {
+            const CANMessage &all = full.message(rowOf(full, id));
+            QVector<quint64> expected;
+            for(quint64 t : all.changes.times())
+            {
+                if((t < ts) && (!afterClear || (t > times[cleared]))) expected.append(t);
+            }
+            const CANMessage &msg = restored.message(rowOf(restored, id));
+            QCOMPARE(msg.changes.times(), expected);
+            QCOMPARE(msg.changeLog.size(), expected.size());
+        }
+        QCOMPARE(rowOf(restored, 0x300) >= 0, ts > 1040005000ull);
+    }
+}
+
+void TestSidecarIndex::otherSettings()
+{
+    LogModel changes(nullptr);
+    load(changes, _log);
+    SidecarIndex index;
+    QVERIFY(index.open(_log));
+    QVERIFY(index.settings() == changes.indexSettings());
+
+    // checkpoints with change logs are no use for a mask run, it parses
+    // the log again and indexes it under its own modes
+    LogModel masks(nullptr);
+    masks.setUseIndex(true);
+    masks.setGenMask(true);
+    masks.loadLogs(QStringList(_log));
+    QCOMPARE(masks.rowCount(), 2);
+    for(int i = 0; i < masks.rowCount(); i++) QVERIFY(masks.message(i).changeLog.isEmpty());
+    const CANMessage &msg = masks.message(rowOf(masks, 0x100));
+    QVERIFY(msg.bitmask != msg.mask);
+    QVERIFY(index.open(_log));
+    QVERIFY(index.settings().genMask);
+    QVERIFY(!index.settings().logChange);
+
+    // and a journaled mask is applied while parsing
+    Journal journal;
+    QVERIFY(journal.open(_dir.filePath("settings.journal")));
+    LogModel journaled(nullptr);
+    journaled.setLogChange(true);
+    journaled.setJournal(&journal);
+    QVERIFY(journaled.indexSettings() == changes.indexSettings());
+    journal.logMask("can0", 0x100, 2, 0x00ff);
+    QVERIFY(journaled.indexSettings() != changes.indexSettings());
+}
+
+void TestSidecarIndex::relog()
+{
+    LogModel model(nullptr);
+    load(model, _bigLog);
+    QVERIFY(model.canSeek());
+
+    SidecarIndex index;
+    QVERIFY(index.open(_bigLog));
+    QVector<SidecarIndex::Range> ranges = index.ranges("can0", 0x300);
+    QCOMPARE(ranges.size(), 1);
+    QVERIFY(ranges.first().start > 0);
+    QVERIFY(ranges.first().end < QFileInfo(_bigLog).size());
+    ranges = index.ranges("can0", 0x100);
+    QCOMPARE(ranges.size(), 1);
+    QCOMPARE(ranges.first().start, qint64(0));
+    QCOMPARE(ranges.first().end, QFileInfo(_bigLog).size());
+    QVERIFY(index.ranges("can1", 0x100).isEmpty());
+
+    // narrowing 0x200 to its second byte drops bits it has changed, the
+    // history is read again for that ID alone instead of being lost
+    Journal journal;
+    QVERIFY(journal.open(_dir.filePath("relog.journal")));
+    journal.logMask("can1", 0x200, 2, 0x00ff);
+    LogModel expected(nullptr);
+    expected.setLogChange(true);
+    expected.setJournal(&journal);
+    expected.loadLogs(QStringList(_bigLog));
+    const CANMessage &want = expected.message(rowOf(expected, 0x200));
+    QCOMPARE(want.chbits, quint64(0x06));
+
+    int row = rowOf(model, 0x200);
+    QCOMPARE(model.message(row).chbits, quint64(0x0606));
+    QVERIFY(model.setData(model.index(row, 3), QString("00ff")));
+    const CANMessage &msg = model.message(row);
+    QCOMPARE(msg.bitmask, quint64(0xff));
+    QCOMPARE(msg.chbits, want.chbits);
+    QCOMPARE(msg.changeLog.size(), want.changeLog.size());
+    QCOMPARE(msg.changes.times(), want.changes.times());
+    QCOMPARE(msg.changes.deltas(), want.changes.deltas());
+}
+
+QTEST_GUILESS_MAIN(TestSidecarIndex)
+#include "tst_sidecarindex.moc"
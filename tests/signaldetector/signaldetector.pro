@@ -0,0 +1,5 @@
+include(../core.pri)
+
+TARGET = tst_signaldetector
+
+SOURCES += tst_signaldetector.cpp
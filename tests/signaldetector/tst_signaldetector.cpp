@@ -0,0 +1,216 @@
+#include <QtTest>
+#include "signaldetector.h"
+
+// Payloads are built byte by byte, byte 0 is the most significant.
+class TestSignalDetector : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void byteCounter();
+    void nibbleCounter();
+    void fewSamples();
+    void missRate();
+    void oldSamplesFade();
+    void checksums_data();
+    void checksums();
+    void noise();
+    void equalBytes();
+    void twoByteCrc();
+
+private:
+    static quint64 pack(const quint8 *bytes, int len);
+};
+
+// small xorshift, the same bytes on every run
+class Bytes
+{
+public:
+    quint8 next()
+    {
+        _state ^= _state << 13;
+        _state ^= _state >> 7;
+        _state ^= _state << 17;
+        return quint8(_state >> 24);
+    }
+
+private:
+    quint64 _state = 7;
+};
+
+quint64 TestSignalDetector::pack(const quint8 *bytes, int len)
+{
+    quint64 res = 0;
+    for(int i = 0; i < len; i++) res = (res << 8) | bytes[i];
+    return res;
+}
+
+void TestSignalDetector::byteCounter()
+{
+    // byte 2 counts through its wrap from 0xff to 0x00
+    SignalDetector detector;
+    quint8 bytes[8] = { 1, 2, 0xf0, 4, 5, 6, 7, 8 };
+    quint64 known = 0;
+    for(int i = 0; i < 40; i++)
+    {
+        bytes[2]++;
+        known = detector.feed(pack(bytes, 8), 8);
+    }
+    QCOMPARE(known, quint64(0xff) << 40);
+    QCOMPARE(detector.describe(), QString("counter byte 2"));
+}
+
+void TestSignalDetector::nibbleCounter()
+{
+    // the low nibble of byte 3 counts and wraps, the high nibble stays
+    SignalDetector detector;
+    Bytes random;
+    quint8 bytes[8] = { 0 };
+    quint64 known = 0;
+    for(int i = 0; i < 40; i++)
+    {
+        bytes[3] = 0xa0 | ((bytes[3] + 1) & 0x0f);
+        bytes[0] = random.next();
+        known = detector.feed(pack(bytes, 8), 8);
+    }
+    QCOMPARE(known, quint64(0xf) << 32);
+    QCOMPARE(detector.describe(), QString("counter nibble 3.lo"));
+}
+
+void TestSignalDetector::fewSamples()
+{
+    // 16 samples are needed before anything is confirmed
+    SignalDetector detector;
+    quint8 bytes[8] = { 0 };
+    for(int i = 0; i < 10; i++)
+    {
+        bytes[7]++;
+        QCOMPARE(detector.feed(pack(bytes, 8), 8), quint64(0));
+    }
+    for(int i = 0; i < 8; i++)
+    {
+        bytes[7]++;
+        detector.feed(pack(bytes, 8), 8);
+    }
+    QCOMPARE(detector.known(), quint64(0xff));
+}
+
+void TestSignalDetector::missRate()
+{
+    // at most one miss in 32 samples, a jump every 20th frame is too many
+    for(int every : { 20, 50 })
+    {
+        SignalDetector detector;
+        Bytes random;
+        quint8 bytes[8] = { 0 };
+        for(int i = 1; i <= 600; i++)
+        {
+            bytes[7]++;
+            if((i % every) == 0) bytes[7] += 5;
+            bytes[0] = random.next();
+            detector.feed(pack(bytes, 8), 8);
+        }
+        QCOMPARE(detector.known(), (every == 50) ? quint64(0xff) : quint64(0));
+    }
+}
+
+void TestSignalDetector::oldSamplesFade()
+{
+    // a long perfect run is halved away once the counter starts missing
+    SignalDetector detector;
+    Bytes random;
+    quint8 bytes[8] = { 0 };
+    for(int i = 1; i <= 3000; i++)
+    {
+        bytes[7]++;
+        if((i > 1500) && ((i % 10) == 0)) bytes[7] += 5;
+        bytes[0] = random.next();
+        detector.feed(pack(bytes, 8), 8);
+        if(i == 1500) QCOMPARE(detector.known(), quint64(0xff));
+    }
+    QCOMPARE(detector.known(), quint64(0));
+}
+
+void TestSignalDetector::checksums_data()
+{
+    QTest::addColumn<int>("type");
+    QTest::addColumn<bool>("first");
+    QTest::addColumn<quint64>("known");
+    QTest::addColumn<QString>("description");
+
+    // a XOR over the whole frame holds for every byte, it is reported last
+    QTest::newRow("xor first") << int(SignalDetector::Xor) << true << quint64(0xff) << QString("XOR byte 7");
+    QTest::newRow("xor last") << int(SignalDetector::Xor) << false << quint64(0xff) << QString("XOR byte 7");
+    QTest::newRow("sum first") << int(SignalDetector::Sum) << true << (quint64(0xff) << 56) << QString("sum byte 0");
+    QTest::newRow("sum last") << int(SignalDetector::Sum) << false << quint64(0xff) << QString("sum byte 7");
+    QTest::newRow("crc first") << int(SignalDetector::Crc8J1850) << true << (quint64(0xff) << 56) << QString("CRC-8 J1850 byte 0");
+    QTest::newRow("crc last") << int(SignalDetector::Crc8J1850) << false << quint64(0xff) << QString("CRC-8 J1850 byte 7");
+    QTest::newRow("crc zero first") << int(SignalDetector::Crc8J1850Zero) << true << (quint64(0xff) << 56) << QString("CRC-8 J1850/zero byte 0");
+    QTest::newRow("crc zero last") << int(SignalDetector::Crc8J1850Zero) << false << quint64(0xff) << QString("CRC-8 J1850/zero byte 7");
+}
+
+void TestSignalDetector::checksums()
+{
+    QFETCH(int, type);
+    QFETCH(bool, first);
+    QFETCH(quint64, known);
+    QFETCH(QString, description);
+
+    SignalDetector detector;
+    Bytes random;
+    quint8 bytes[8];
+    for(int i = 0; i < 100; i++)
+    {
+        for(quint8 &b : bytes) b = random.next();
+        if(first) bytes[0] = SignalDetector::checksum(SignalDetector::Checksum(type), bytes + 1, 7);
+        else bytes[7] = SignalDetector::checksum(SignalDetector::Checksum(type), bytes, 7);
+        detector.feed(pack(bytes, 8), 8);
+    }
+    QCOMPARE(detector.known(), known);
+    QCOMPARE(detector.describe(), description);
+}
+
+void TestSignalDetector::noise()
+{
+    SignalDetector detector;
+    Bytes random;
+    quint8 bytes[8];
+    for(int i = 0; i < 2000; i++)
+    {
+        for(quint8 &b : bytes) b = random.next();
+        QCOMPARE(detector.feed(pack(bytes, 8), 8), quint64(0));
+    }
+    QVERIFY(detector.describe().isEmpty());
+}
+
+void TestSignalDetector::equalBytes()
+{
+    // XOR or sum of one byte is that byte, equal bytes must not pass as a checksum
+    SignalDetector detector;
+    Bytes random;
+    quint8 bytes[2];
+    for(int i = 0; i < 200; i++)
+    {
+        bytes[0] = bytes[1] = random.next();
+        detector.feed(pack(bytes, 2), 2);
+    }
+    QCOMPARE(detector.known(), quint64(0));
+}
+
+void TestSignalDetector::twoByteCrc()
+{
+    // a CRC of a single byte is still a checksum
+    SignalDetector detector;
+    Bytes random;
+    quint8 bytes[2];
+    for(int i = 0; i < 200; i++)
+    {
+        bytes[0] = random.next();
+        bytes[1] = SignalDetector::checksum(SignalDetector::Crc8J1850, bytes, 1);
+        detector.feed(pack(bytes, 2), 2);
+    }
+    QCOMPARE(detector.known(), quint64(0xff));
+}
+
+QTEST_GUILESS_MAIN(TestSignalDetector)
+#include "tst_signaldetector.moc"
@@ -0,0 +1,8 @@
+include(../core.pri)
+
+TARGET = tst_socketcansource
+
+SOURCES += tst_socketcansource.cpp \
+    $$SRC/socketcansource.cpp
+
+HEADERS += $$SRC/socketcansource.h
@@ -0,0 +1,297 @@
+#include <QtTest>
+#include <cstring>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include "logmodel.h"
+#include "socketcansource.h"
+
+// Control messages and frames are built by hand, no CAN hardware needed.
+// Whole datagrams go through a socketpair, or vcan0 where it exists.
+class TestSocketCanSource : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void hardwareStamp();
+    void softwareStamp();
+    void timestampNs();
+    void overflow();
+    void noControl();
+    void truncatedControl();
+    void classicFrame();
+    void fdFrame();
+    void badLength();
+    void socketPair();
+    void vcanDrops();
+};
+
+// room for any two of the messages parseControl reads
+class Control
+{
+public:
+    Control()
+    {
+        memset(&hdr, 0, sizeof(hdr));
+        memset(buffer, 0, sizeof(buffer));
+        hdr.msg_control = buffer;
+        hdr.msg_controllen = sizeof(buffer);
+    }
+
+    void add(int type, const void *data, size_t len, size_t cmsgLen = 0)
+    {
+        cmsghdr *cmsg = last ? CMSG_NXTHDR(&hdr, last) : CMSG_FIRSTHDR(&hdr);
+        QVERIFY(cmsg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = type;
+        cmsg->cmsg_len = cmsgLen ? cmsgLen : CMSG_LEN(len);
+        memcpy(CMSG_DATA(cmsg), data, len);
+        last = cmsg;
+        used += CMSG_SPACE(len);
+    }
+
+    msghdr *finish()
+    {
+        hdr.msg_controllen = used;
+        return &hdr;
+    }
+
+    msghdr hdr;
+    cmsghdr *last = nullptr;
+    size_t used = 0;
+    alignas(cmsghdr) char buffer[2 * CMSG_SPACE(sizeof(scm_timestamping))];
+};
+
+void TestSocketCanSource::hardwareStamp()
+{
+    scm_timestamping stamps;
+    memset(&stamps, 0, sizeof(stamps));
+    stamps.ts[0].tv_sec = 100;
+    stamps.ts[0].tv_nsec = 5000;
+    stamps.ts[2].tv_sec = 200;
+    stamps.ts[2].tv_nsec = 7000;
+    Control control;
+    control.add(SCM_TIMESTAMPING, &stamps, sizeof(stamps));
+
+    timespec ts = { 1, 1 };
+    quint32 drops = 0;
+    SocketCanSource::parseControl(control.finish(), ts, drops);
+    QCOMPARE(qint64(ts.tv_sec), qint64(200));
+    QCOMPARE(qint64(ts.tv_nsec), qint64(7000));
+}
+
+void TestSocketCanSource::softwareStamp()
+{
+    scm_timestamping stamps;
+    memset(&stamps, 0, sizeof(stamps));
+    stamps.ts[0].tv_sec = 100;
+    stamps.ts[0].tv_nsec = 5000;
+    Control control;
+    control.add(SCM_TIMESTAMPING, &stamps, sizeof(stamps));
+
+    timespec ts = { 1, 1 };
+    quint32 drops = 0;
+    SocketCanSource::parseControl(control.finish(), ts, drops);
+    QCOMPARE(qint64(ts.tv_sec), qint64(100));
+    QCOMPARE(qint64(ts.tv_nsec), qint64(5000));
+}
+
+void TestSocketCanSource::timestampNs()
+{
+    timespec stamp = { 300, 999999999 };
+    Control control;
+    control.add(SCM_TIMESTAMPNS, &stamp, sizeof(stamp));
+
+    timespec ts = { 1, 1 };
+    quint32 drops = 0;
+    SocketCanSource::parseControl(control.finish(), ts, drops);
+    QCOMPARE(qint64(ts.tv_sec), qint64(300));
+    QCOMPARE(qint64(ts.tv_nsec), qint64(999999999));
+}
+
+void TestSocketCanSource::overflow()
+{
+    timespec stamp = { 300, 0 };
+    quint32 count = 0xfffffffe;
+    Control control;
+    control.add(SCM_TIMESTAMPNS, &stamp, sizeof(stamp));
+    control.add(SO_RXQ_OVFL, &count, sizeof(count));
+
+    timespec ts = { 1, 1 };
+    quint32 drops = 7;
+    SocketCanSource::parseControl(control.finish(), ts, drops);
+    QCOMPARE(drops, quint32(0xfffffffe));
+    QCOMPARE(qint64(ts.tv_sec), qint64(300));
+}
+
+void TestSocketCanSource::noControl()
+{
+    Control control;
+    timespec ts = { 42, 43 };
+    quint32 drops = 5;
+    SocketCanSource::parseControl(control.finish(), ts, drops);
+    QCOMPARE(qint64(ts.tv_sec), qint64(42));
+    QCOMPARE(qint64(ts.tv_nsec), qint64(43));
+    QCOMPARE(drops, quint32(5));
+}
+
+void TestSocketCanSource::truncatedControl()
+{
+    // a message too short for its type is skipped, not read past its end
+    quint32 count = 9;
+    Control control;
+    control.add(SCM_TIMESTAMPING, &count, sizeof(count));
+
+    timespec ts = { 42, 43 };
+    quint32 drops = 5;
+    SocketCanSource::parseControl(control.finish(), ts, drops);
+    QCOMPARE(qint64(ts.tv_sec), qint64(42));
+    QCOMPARE(drops, quint32(5));
+}
+
+void TestSocketCanSource::classicFrame()
+{
+    canfd_frame rx;
+    memset(&rx, 0, sizeof(rx));
+    rx.can_id = 0x18daf110 | CAN_EFF_FLAG;
+    rx.len = 12;        // over CAN_MAX_DLEN, clipped for classic frames
+    for(int i = 0; i < 12; i++) rx.data[i] = i + 1;
+    timespec ts = { 1500000000, 123456789 };
+
+    CANFrame f;
+    QVERIFY(SocketCanSource::convert(rx, CAN_MTU, ts, 3, f));
+    QCOMPARE(f.id, quint32(0x18daf110));
+    QCOMPARE(int(f.flags), int(CANFrame::Extended));
+    QCOMPARE(int(f.length), 8);
+    QCOMPARE(f.sec, quint64(1500000000));
+    QCOMPARE(f.usec, quint32(123456));
+    QCOMPARE(int(f.bus), 3);
+    QCOMPARE(f.payload(), quint64(0x0102030405060708ull));
+}
+
+void TestSocketCanSource::fdFrame()
+{
+    canfd_frame rx;
+    memset(&rx, 0, sizeof(rx));
+    rx.can_id = 0x123;
+    rx.len = 64;
+    rx.data[63] = 0xaa;
+    timespec ts = { 1, 0 };
+
+    CANFrame f;
+    QVERIFY(SocketCanSource::convert(rx, CANFD_MTU, ts, 0, f));
+    QCOMPARE(f.id, quint32(0x123));
+    QCOMPARE(int(f.flags), int(CANFrame::FD));
+    QCOMPARE(int(f.length), 64);
+    QCOMPARE(int(f.data[63]), 0xaa);
+}
+
+void TestSocketCanSource::badLength()
+{
+    canfd_frame rx;
+    memset(&rx, 0, sizeof(rx));
+    timespec ts = { 1, 0 };
+    CANFrame f;
+    QVERIFY(!SocketCanSource::convert(rx, CAN_MTU - 1, ts, 0, f));
+    QVERIFY(!SocketCanSource::convert(rx, 0, ts, 0, f));
+}
+
+void TestSocketCanSource::socketPair()
+{
+    int fds[2];
+    QVERIFY(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, fds) == 0);
+    LogModel model(nullptr);
+    SocketCanSource source(&model);
+    QVERIFY(source.openDescriptor(fds[0], "vcan9"));
+
+    // more than one recvmmsg batch, and well inside the default send buffer
+    canfd_frame rx;
+    for(int i = 0; i < 200; i++)
+    {
+        memset(&rx, 0, sizeof(rx));
+        rx.can_id = 0x100 + (i % 4);
+        rx.len = 2;
+        rx.data[0] = quint8(i >> 8);
+        rx.data[1] = quint8(i);
+        QCOMPARE(write(fds[1], &rx, CAN_MTU), ssize_t(CAN_MTU));
+    }
+    memset(&rx, 0, sizeof(rx));
+    rx.can_id = 0x18daf110 | CAN_EFF_FLAG;
+    rx.len = 64;
+    rx.data[63] = 0xaa;
+    QCOMPARE(write(fds[1], &rx, CANFD_MTU), ssize_t(CANFD_MTU));
+    // neither MTU, dropped without ending the batch
+    QCOMPARE(write(fds[1], &rx, 7), ssize_t(7));
+    rx.can_id = 0x200;
+    rx.len = 1;
+    rx.data[0] = 0x55;
+    QCOMPARE(write(fds[1], &rx, CAN_MTU), ssize_t(CAN_MTU));
+
+    // rows as the table shows them
+    QTRY_COMPARE(model.stats()->counter(PipelineStats::FramesIn), quint64(202));
+    QCOMPARE(model.rowCount(), 6);
+    QMap<quint32, QString> rows;
+    for(int i = 0; i < model.rowCount(); i++)
+    {
+        QCOMPARE(model.data(model.index(i, 0)).toString(), QString("vcan9"));
+        rows.insert(model.data(model.index(i, 1)).toString().toUInt(nullptr, 16), model.data(model.index(i, 2)).toString());
+    }
+    // the last of the 200 frames for each ID, FD payloads clipped to 8 bytes
+    QCOMPARE(rows.value(0x100), QString("00 c4"));
+    QCOMPARE(rows.value(0x103), QString("00 c7"));
+    QCOMPARE(rows.value(0x200), QString("55"));
+    QCOMPARE(rows.value(0x18daf110), QString("00 00 00 00 00 00 00 00"));
+    // a socketpair carries no timestamps or drop counts
+    QCOMPARE(source.drops(), quint32(0));
+    QCOMPARE(model.stats()->gauge(PipelineStats::KernelDrops), quint64(0));
+
+    source.close();
+    ::close(fds[1]);
+}
+
+void TestSocketCanSource::vcanDrops()
+{
+    if(!SocketCanSource::interfaces().contains("vcan0")) QSKIP("No vcan0 interface");
+
+    LogModel model(nullptr);
+    SocketCanSource source(&model);
+    QVERIFY2(source.open("vcan0"), qPrintable(source.errorString()));
+
+    int fd = ::socket(PF_CAN, SOCK_RAW | SOCK_CLOEXEC, CAN_RAW);
+    QVERIFY(fd >= 0);
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, "vcan0", IFNAMSIZ - 1);
+    QVERIFY(ioctl(fd, SIOCGIFINDEX, &ifr) == 0);
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    QVERIFY(bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0);
+
+    // the event loop does not run while sending, the receive buffer overflows;
+    // frames queued before that carry no drops, the one sent after draining does
+    const int sent = 100000;
+    can_frame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.can_id = 0x123;
+    frame.can_dlc = 1;
+    for(int i = 0; i < sent; i++)
+    {
+        frame.data[0] = quint8(i);
+        QCOMPARE(write(fd, &frame, CAN_MTU), ssize_t(CAN_MTU));
+    }
+    QTRY_VERIFY(model.stats()->counter(PipelineStats::FramesIn) > 0);
+    QTest::qWait(100);
+    QCOMPARE(write(fd, &frame, CAN_MTU), ssize_t(CAN_MTU));
+    QTRY_VERIFY(source.drops() > 0);
+    QCOMPARE(model.stats()->counter(PipelineStats::FramesIn) + source.drops(), quint64(sent + 1));
+    QCOMPARE(model.stats()->gauge(PipelineStats::KernelDrops), quint64(source.drops()));
+
+    ::close(fd);
+}
+
+QTEST_GUILESS_MAIN(TestSocketCanSource)
+#include "tst_socketcansource.moc"
@@ -0,0 +1,9 @@
+# Unit tests, run with "make check" in the build directory.
+
+TEMPLATE = subdirs
+
+SUBDIRS += blfreader candumpreader captureserver changeindex correlator pcapreader remoteprotocol sharding sidecarindex signaldetector cangen
+
+linux {
+    SUBDIRS += socketcansource
+}
@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# Synthetic CAN traffic generator for load tests
+#
+#-------------------------------------------------
+
+QT       += core serialbus
+QT       -= gui
+
+TARGET = cangen
+TEMPLATE = app
+
+CONFIG += console c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    generator.cpp \
+    ../../signaldetector.cpp
+
+HEADERS += generator.h \
+    ../../canframe.h \
+    ../../signaldetector.h
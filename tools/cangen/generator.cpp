@@ -0,0 +1,325 @@
+#include "generator.h"
+#include <QSet>
+#include <QStringList>
+#include <algorithm>
+#include <cstring>
+#include "signaldetector.h"
+
+// about 30 years, far inside quint64 microseconds
+const double maxEventSeconds = 1e9;
+
+Rng::Rng(quint64 seed)
+{
+    // splitmix64 spreads small seeds, the state must not be zero
+    quint64 z = seed + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    _state = (z ^ (z >> 31)) | 1;
+}
+
+quint64 Rng::next()
+{
+    _state ^= _state >> 12;
+    _state ^= _state << 25;
+    _state ^= _state >> 27;
+    return _state * 0x2545f4914f6cdd1dull;
+}
+
+// seconds to microseconds, converting a negative or huge double is undefined
+static quint64 toMicroseconds(const QString &text, bool *ok)
+{
+    double sec = text.toDouble(ok);
+    // NaN fails both comparisons
+    if(!(sec >= 0) || !(sec <= maxEventSeconds))
+    {
+        *ok = false;
+        return 0;
+    }
+    return quint64(sec * 1000000);
+}
+
+bool GeneratorEvent::parse(const QString &text, GeneratorEvent &ev)
+{
+    QStringList parts = text.split(',');
+    if((parts.size() < 4) || (parts.size() > 5)) return false;
+
+    bool ok[5] = { true, true, true, true, true };
+    ev.time = toMicroseconds(parts[0], &ok[0]);
+    ev.id = parts[1].toUInt(&ok[1], 16);
+    ev.byte = parts[2].toInt(&ok[2]);
+    uint value = parts[3].toUInt(&ok[3], 16);
+    if(parts.size() > 4) ev.duration = toMicroseconds(parts[4], &ok[4]);
+    for(bool b : ok)
+    {
+        if(!b) return false;
+    }
+    if((ev.byte < 0) || (ev.byte >= 64) || (value > 0xff) || (ev.id > 0x1fffffff)) return false;
+    ev.value = value;
+    return true;
+}
+
+Generator::Generator(const GeneratorConfig &config) : _rng(config.seed)
+{
+    _config = config;
+    _config.jitter = qBound(0.0, _config.jitter, 0.9);
+
+    _config.buses = qMax(1, _config.buses);
+    QSet<quint64> used;
+    QVector<int> standard(_config.buses);
+    for(int i = 0; i < _config.ids; i++)
+    {
+        quint16 bus = _rng.below(_config.buses);
+        // 11 bit IDs run out after 2048 per bus
+        bool extended = _rng.chance(_config.extended) || (standard[bus] >= 2048);
+        quint32 id;
+        quint64 key;
+        do
+        {
+            id = extended ? (_rng.below(0x1fffffff - 0x7ff) + 0x800) : _rng.below(0x800);
+            key = (quint64(bus) << 32) | id;
+        }
+        while(used.contains(key));
+        used.insert(key);
+        if(!extended) standard[bus]++;
+        addSource(id, bus, extended);
+    }
+
+    // events apply to the first source with their ID on any bus,
+    // an ID no bus has yet is added on the first one
+    for(int e = 0; e < _config.events.size(); e++)
+    {
+        const GeneratorEvent &ev = _config.events[e];
+        int ix = -1;
+        for(int i = 0; (i < _sources.size()) && (ix < 0); i++)
+        {
+            if(_sources[i].id == ev.id) ix = i;
+        }
+        if(ix < 0)
+        {
+            addSource(ev.id, 0, ev.id > 0x7ff, ev.byte + 1);
+            ix = _sources.size() - 1;
+        }
+        Source &s = _sources[ix];
+        if(ev.byte < s.length) s.events.append(e);
+        else _unplaced.append(e);
+    }
+
+    _heap.reserve(_sources.size());
+    auto cmp = [this](int a, int b) { return later(a, b); };
+    for(int i = 0; i < _sources.size(); i++)
+    {
+        _heap.append(i);
+        std::push_heap(_heap.begin(), _heap.end(), cmp);
+    }
+}
+
+void Generator::addSource(quint32 id, quint16 bus, bool extended, int minLength)
+{
+    static const quint64 periods[] = { 10, 20, 25, 50, 100, 200, 250, 500, 1000, 2000, 5000 };
+    static const quint8 fdLengths[] = { 12, 16, 20, 24, 32, 48, 64 };
+
+    Source s;
+    s.id = id;
+    s.bus = bus;
+    s.flags = extended ? CANFrame::Extended : 0;
+    if(_rng.chance(_config.fd))
+    {
+        s.flags |= CANFrame::FD;
+        s.length = fdLengths[_rng.below(sizeof(fdLengths))];
+    }
+    else
+    {
+        s.length = _rng.chance(0.8) ? 8 : (_rng.below(8) + 1);
+    }
+    if(s.length < minLength)
+    {
+        // the shortest frame holding the scripted byte
+        if(minLength <= 8)
+        {
+            s.length = minLength;
+        }
+        else
+        {
+            s.flags |= CANFrame::FD;
+            s.length = 64;
+            for(quint8 len : fdLengths)
+            {
+                if(len >= minLength)
+                {
+                    s.length = len;
+                    break;
+                }
+            }
+        }
+    }
+
+    QVector<quint64> allowed;
+    for(quint64 p : periods)
+    {
+        p *= 1000;
+        if((p >= _config.periodMin) && (p <= _config.periodMax)) allowed.append(p);
+    }
+    if(allowed.isEmpty()) allowed.append(qMax(quint64(1), _config.periodMin));
+    s.period = allowed[_rng.below(allowed.size())];
+    s.next = _rng.below(quint32(qMin(s.period, quint64(0xffffffff))));
+
+    for(int i = 0; i < s.length; i++) s.data[i] = _rng.below(256);
+    s.counter = -1;
+    s.counterNibble = false;
+    s.checksum = -1;
+    s.noise = -1;
+    s.noiseMask = 0;
+    s.signal = -1;
+
+    // the usual layout, checksum last with the counter right before it
+    int n = qMin(int(s.length), 8);
+    if((n >= 2) && _rng.chance(_config.checksums))
+    {
+        s.checksum = _rng.below(SignalDetector::ChecksumEnd);
+    }
+    if((n >= (s.checksum >= 0 ? 2 : 1)) && _rng.chance(_config.counters))
+    {
+        s.counter = n - (s.checksum >= 0 ? 2 : 1);
+        s.counterNibble = _rng.chance(0.5);
+    }
+    if(_rng.chance(_config.noise))
+    {
+        s.noise = freeByte(s, n);
+        s.noiseMask = _rng.chance(0.5) ? 0x01 : 0x03;
+    }
+    s.signal = freeByte(s, n);
+
+    _sources.append(s);
+}
+
+// random byte of the first n not taken by a counter, checksum or noise
+int Generator::freeByte(const Source &s, int n)
+{
+    int free[8];
+    int count = 0;
+    for(int i = 0; i < n; i++)
+    {
+        if((i != s.counter) && (i != s.noise) && !((s.checksum >= 0) && (i == n - 1))) free[count++] = i;
+    }
+    return count ? free[_rng.below(count)] : -1;
+}
+
+bool Generator::later(int a, int b) const
+{
+    if(_sources[a].next != _sources[b].next) return _sources[a].next > _sources[b].next;
+    return a > b;
+}
+
+void Generator::next(CANFrame &frame, quint64 &offset)
+{
+    auto cmp = [this](int a, int b) { return later(a, b); };
+    std::pop_heap(_heap.begin(), _heap.end(), cmp);
+    Source &s = _sources[_heap.last()];
+    offset = s.next;
+
+    if((s.signal >= 0) && _rng.chance(_config.changes)) s.data[s.signal] = _rng.below(256);
+    if(s.noise >= 0) s.data[s.noise] = (s.data[s.noise] & ~s.noiseMask) | (_rng.next() & s.noiseMask);
+    if(s.counter >= 0)
+    {
+        quint8 &c = s.data[s.counter];
+        c = s.counterNibble ? ((c & 0xf0) | ((c + 1) & 0x0f)) : quint8(c + 1);
+    }
+
+    quint64 ts = _config.start * 1000000 + offset;
+    frame.sec = ts / 1000000;
+    frame.usec = ts % 1000000;
+    frame.bus = s.bus;
+    frame.flags = s.flags;
+    frame.length = s.length;
+    frame.id = s.id;
+    memcpy(frame.data, s.data, s.length);
+    int n = qMin(int(s.length), 8);
+    bool checksum = (s.checksum >= 0);
+    for(int e : s.events)
+    {
+        const GeneratorEvent &ev = _config.events[e];
+        if((offset < ev.time) || (offset >= ev.time + ev.duration)) continue;
+        frame.data[ev.byte] = ev.value;
+        // a scripted value wins over the checksum too
+        if(ev.byte == n - 1) checksum = false;
+    }
+    if(checksum)
+    {
+        frame.data[n - 1] = SignalDetector::checksum(SignalDetector::Checksum(s.checksum), frame.data, n - 1);
+    }
+
+    double jitter = (_rng.unit() * 2.0 - 1.0) * _config.jitter;
+    s.next += qMax(quint64(1), quint64(s.period * (1.0 + jitter)));
+    std::push_heap(_heap.begin(), _heap.end(), cmp);
+}
+
+QString Generator::describe(int ix) const
+{
+    const Source &s = _sources[ix];
+    QString res = QString("can%1 %2 %3%4 bytes every %5 ms")
+            .arg(s.bus)
+            .arg(s.id, (s.flags & CANFrame::Extended) ? 8 : 3, 16, QChar('0'))
+            .arg((s.flags & CANFrame::FD) ? "FD " : "")
+            .arg(s.length)
+            .arg(s.period / 1000.0);
+    if(s.counter >= 0) res += QString(", counter %1 in byte %2").arg(s.counterNibble ? "nibble" : "byte").arg(s.counter);
+    if(s.checksum >= 0)
+    {
+        res += QString(", %1 in byte %2")
+                .arg(SignalDetector::checksumName(SignalDetector::Checksum(s.checksum)))
+                .arg(qMin(int(s.length), 8) - 1);
+    }
+    if(s.noise >= 0) res += QString(", noise 0x%1 in byte %2").arg(s.noiseMask, 2, 16, QChar('0')).arg(s.noise);
+    if(s.signal >= 0) res += QString(", signal in byte %1").arg(s.signal);
+    return res;
+}
+
+int Generator::formatCandump(const CANFrame &frame, const char *bus, int busLen, char *out)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    char *p = out;
+
+    *p++ = '(';
+    char digits[20];
+    int n = 0;
+    quint64 sec = frame.sec;
+    do
+    {
+        digits[n++] = '0' + (sec % 10);
+        sec /= 10;
+    }
+    while(sec);
+    while(n) *p++ = digits[--n];
+    *p++ = '.';
+    quint32 usec = frame.usec;
+    for(int i = 5; i >= 0; i--)
+    {
+        p[i] = '0' + (usec % 10);
+        usec /= 10;
+    }
+    p += 6;
+    *p++ = ')';
+    *p++ = ' ';
+
+    memcpy(p, bus, busLen);
+    p += busLen;
+    *p++ = ' ';
+
+    for(int shift = (frame.flags & CANFrame::Extended) ? 28 : 8; shift >= 0; shift -= 4)
+    {
+        *p++ = hex[(frame.id >> shift) & 0xf];
+    }
+    *p++ = '#';
+    if(frame.flags & CANFrame::FD)
+    {
+        *p++ = '#';
+        *p++ = '0';
+    }
+    for(int i = 0; i < frame.length; i++)
+    {
+        *p++ = hex[frame.data[i] >> 4];
+        *p++ = hex[frame.data[i] & 0xf];
+    }
+    *p++ = '\n';
+    return p - out;
+}
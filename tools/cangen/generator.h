@@ -0,0 +1,106 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <QString>
+#include <QVector>
+#include "canframe.h"
+
+// xorshift64*, the same sequence for a seed with every compiler and library
+class Rng
+{
+public:
+    explicit Rng(quint64 seed = 1);
+
+    quint64 next();
+    // uniform in [0, n)
+    quint32 below(quint32 n) { return quint32(((next() >> 32) * n) >> 32); }
+    // uniform in [0, 1)
+    double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+    bool chance(double p) { return unit() < p; }
+
+private:
+    quint64 _state;
+};
+
+// Scripted payload override, "TIME,ID,BYTE,VALUE[,DURATION]" with times in
+// seconds from the start and ID and value in hex.
+class GeneratorEvent
+{
+public:
+    static bool parse(const QString &text, GeneratorEvent &ev);
+
+    quint64 time = 0;
+    quint64 duration = 1000000;
+    quint32 id = 0;
+    int byte = 0;
+    quint8 value = 0;
+};
+
+class GeneratorConfig
+{
+public:
+    int ids = 100;
+    int buses = 1;
+    quint64 periodMin = 10000;      // usec
+    quint64 periodMax = 1000000;
+    double jitter = 0.05;           // of the period
+    double extended = 0.1;          // share of IDs
+    double fd = 0.0;
+    double counters = 0.3;
+    double checksums = 0.3;
+    double noise = 0.2;
+    double changes = 0.01;          // chance per frame of a signal change
+    quint64 start = 1500000000;     // sec
+    quint64 seed = 1;
+    QVector<GeneratorEvent> events;
+};
+
+// Periodic traffic of a random but reproducible set of IDs, frames come out
+// in time order. Counters and checksums sit in the first 8 bytes where
+// SignalDetector looks for them.
+class Generator
+{
+public:
+    explicit Generator(const GeneratorConfig &config);
+
+    // time of the frame in usec from the start goes to offset
+    void next(CANFrame &frame, quint64 &offset);
+    int size() const { return _sources.size(); }
+    QString describe(int ix) const;
+    // events on an ID whose frames are too short for their byte
+    const QVector<int> &unplacedEvents() const { return _unplaced; }
+
+    // candump -L line with newline, returns its length, needs 200 bytes
+    static int formatCandump(const CANFrame &frame, const char *bus, int busLen, char *out);
+
+private:
+    struct Source
+    {
+        quint32 id;
+        quint16 bus;
+        quint8 flags;
+        quint8 length;
+        quint64 period;
+        quint64 next;
+        int counter;            // byte index or -1
+        bool counterNibble;
+        int checksum;           // SignalDetector::Checksum or -1
+        int noise;
+        quint8 noiseMask;
+        int signal;
+        QVector<int> events;
+        quint8 data[64];
+    };
+
+    void addSource(quint32 id, quint16 bus, bool extended, int minLength = 0);
+    int freeByte(const Source &s, int n);
+    bool later(int a, int b) const;
+
+    GeneratorConfig _config;
+    Rng _rng;
+    QVector<Source> _sources;
+    QVector<int> _heap;
+    QVector<int> _unplaced;
+};
+
+#endif // GENERATOR_H
@@ -0,0 +1,215 @@
+#include <QCoreApplication>
+#include <QCanBus>
+#include <QCanBusDevice>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+#include <cstdio>
+#include "generator.h"
+
+// Synthetic CAN traffic for load and regression testing, written as a
+// candump log and/or sent live through the virtualcan plugin.
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("cangen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Synthetic CAN traffic generator");
+    parser.addHelpOption();
+    QCommandLineOption outputOption({"o", "output"}, "candump log to write, - for stdout", "file");
+    QCommandLineOption liveOption("live", "Send the frames through the virtualcan plugin in real time, canN per bus");
+    QCommandLineOption speedOption("speed", "Time scale of live traffic", "factor", "1");
+    QCommandLineOption durationOption("duration", "Length of the traffic", "sec", "60");
+    QCommandLineOption framesOption("frames", "Stop after this many frames", "count", "0");
+    QCommandLineOption idsOption("ids", "Number of IDs", "count", "100");
+    QCommandLineOption busesOption("buses", "Number of buses", "count", "1");
+    QCommandLineOption periodMinOption("period-min", "Shortest period", "ms", "10");
+    QCommandLineOption periodMaxOption("period-max", "Longest period", "ms", "1000");
+    QCommandLineOption jitterOption("jitter", "Period jitter", "percent", "5");
+    QCommandLineOption extendedOption("extended", "Share of 29 bit IDs", "percent", "10");
+    QCommandLineOption fdOption("fd", "Share of CAN FD IDs", "percent", "0");
+    QCommandLineOption countersOption("counters", "Share of IDs with an alive counter", "percent", "30");
+    QCommandLineOption checksumsOption("checksums", "Share of IDs with a checksum byte", "percent", "30");
+    QCommandLineOption noiseOption("noise", "Share of IDs with noisy LSBs", "percent", "20");
+    QCommandLineOption changesOption("changes", "Chance of a signal change per frame", "percent", "1");
+    QCommandLineOption eventOption("event", "Scripted override, may be repeated", "sec,id,byte,value[,duration]");
+    QCommandLineOption startOption("start", "Timestamp of the first frame", "sec", "1500000000");
+    QCommandLineOption seedOption("seed", "Random seed, the same seed gives the same traffic", "n", "1");
+    QCommandLineOption verboseOption({"v", "verbose"}, "List the generated IDs on stderr");
+    parser.addOptions({ outputOption, liveOption, speedOption, durationOption, framesOption, idsOption,
+                        busesOption, periodMinOption, periodMaxOption, jitterOption, extendedOption, fdOption,
+                        countersOption, checksumsOption, noiseOption, changesOption, eventOption, startOption,
+                        seedOption, verboseOption });
+    parser.process(a);
+
+    if(!parser.isSet(outputOption) && !parser.isSet(liveOption))
+    {
+        qCritical("Nothing to do, give --output and/or --live");
+        return 1;
+    }
+
+    GeneratorConfig config;
+    config.ids = qMax(0, parser.value(idsOption).toInt());
+    config.buses = qBound(1, parser.value(busesOption).toInt(), 256);
+    config.periodMin = quint64(qMax(0.001, parser.value(periodMinOption).toDouble()) * 1000);
+    config.periodMax = quint64(qMax(0.001, parser.value(periodMaxOption).toDouble()) * 1000);
+    config.jitter = parser.value(jitterOption).toDouble() / 100.0;
+    config.extended = parser.value(extendedOption).toDouble() / 100.0;
+    config.fd = parser.value(fdOption).toDouble() / 100.0;
+    config.counters = parser.value(countersOption).toDouble() / 100.0;
+    config.checksums = parser.value(checksumsOption).toDouble() / 100.0;
+    config.noise = parser.value(noiseOption).toDouble() / 100.0;
+    config.changes = parser.value(changesOption).toDouble() / 100.0;
+    config.start = parser.value(startOption).toULongLong();
+    config.seed = parser.value(seedOption).toULongLong();
+    for(const QString &text : parser.values(eventOption))
+    {
+        GeneratorEvent ev;
+        if(!GeneratorEvent::parse(text, ev))
+        {
+            qCritical("Bad event: %s", qPrintable(text));
+            return 1;
+        }
+        config.events.append(ev);
+    }
+
+    Generator gen(config);
+    if(gen.size() == 0)
+    {
+        qCritical("No IDs to generate");
+        return 1;
+    }
+    for(int e : gen.unplacedEvents())
+    {
+        qCritical("Bad event: %s, byte %d is past the frames of ID %x", qPrintable(parser.values(eventOption).at(e)),
+                  config.events[e].byte, config.events[e].id);
+        return 1;
+    }
+    if(parser.isSet(verboseOption))
+    {
+        for(int i = 0; i < gen.size(); i++) fprintf(stderr, "%s\n", qPrintable(gen.describe(i)));
+    }
+
+    QVector<QByteArray> busNames;
+    for(int i = 0; i < config.buses; i++) busNames.append(QString("can%1").arg(i).toLatin1());
+
+    QFile out;
+    QString output = parser.value(outputOption);
+    if(!output.isEmpty())
+    {
+        bool ok;
+        if(output == "-")
+        {
+            ok = out.open(stdout, QIODevice::WriteOnly);
+        }
+        else
+        {
+            out.setFileName(output);
+            ok = out.open(QIODevice::WriteOnly);
+        }
+        if(!ok)
+        {
+            qCritical("Cannot open %s: %s", qPrintable(output), qPrintable(out.errorString()));
+            return 1;
+        }
+    }
+
+    QVector<QCanBusDevice *> devices;
+    if(parser.isSet(liveOption))
+    {
+        for(const QByteArray &name : busNames)
+        {
+            QString errorString;
+            QCanBusDevice *device = QCanBus::instance()->createDevice("virtualcan", name, &errorString);
+            if(!device || !device->connectDevice())
+            {
+                qCritical("Cannot open virtualcan %s: %s", name.constData(),
+                          qPrintable(device ? device->errorString() : errorString));
+                return 1;
+            }
+            device->setParent(&a);
+            devices.append(device);
+        }
+    }
+
+    // lines go out in large blocks, formatting is the only per frame cost
+    const int bufferSize = 4 * 1024 * 1024;
+    QByteArray buffer(bufferSize + 256, Qt::Uninitialized);
+    int fill = 0;
+    quint64 bytes = 0;
+    auto flush = [&]()
+    {
+        if(out.write(buffer.constData(), fill) != fill)
+        {
+            qCritical("Cannot write %s: %s", qPrintable(output), qPrintable(out.errorString()));
+            return false;
+        }
+        bytes += fill;
+        fill = 0;
+        return true;
+    };
+
+    quint64 duration = quint64(qBound(0.0, parser.value(durationOption).toDouble(), 1e9) * 1000000);
+    quint64 maxFrames = parser.value(framesOption).toULongLong();
+    double speed = qMax(0.001, parser.value(speedOption).toDouble());
+    quint64 frames = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    CANFrame frame;
+    quint64 offset;
+    while(true)
+    {
+        gen.next(frame, offset);
+        if((offset >= duration) || (maxFrames && (frames >= maxFrames))) break;
+        frames++;
+
+        if(out.isOpen())
+        {
+            const QByteArray &bus = busNames[frame.bus];
+            fill += Generator::formatCandump(frame, bus.constData(), bus.size(), buffer.data() + fill);
+            if((fill >= bufferSize) && !flush()) return 1;
+        }
+
+        if(!devices.isEmpty())
+        {
+            qint64 wait = qint64(offset / speed) - timer.nsecsElapsed() / 1000;
+            if(wait > 1000)
+            {
+                a.processEvents();
+                QThread::usleep(wait);
+            }
+            else if((frames & 1023) == 0)
+            {
+                a.processEvents();
+            }
+            QCanBusFrame canFrame(frame.id, QByteArray(reinterpret_cast<const char *>(frame.data), frame.length));
+            canFrame.setExtendedFrameFormat(frame.flags & CANFrame::Extended);
+            canFrame.setFlexibleDataRateFormat(frame.flags & CANFrame::FD);
+            canFrame.setTimeStamp(QCanBusFrame::TimeStamp(frame.sec, frame.usec));
+            devices[frame.bus]->writeFrame(canFrame);
+        }
+    }
+    if(out.isOpen())
+    {
+        if(fill && !flush()) return 1;
+        // a full disk may only show when the last block is flushed
+        if(!out.flush())
+        {
+            qCritical("Cannot write %s: %s", qPrintable(output), qPrintable(out.errorString()));
+            return 1;
+        }
+        out.close();
+    }
+    for(QCanBusDevice *device : devices)
+    {
+        a.processEvents();
+        device->disconnectDevice();
+    }
+
+    double elapsed = qMax(qint64(1), timer.elapsed()) / 1000.0;
+    fprintf(stderr, "%llu frames, %llu bytes in %.2f s, %.1f MB/s\n", frames, bytes, elapsed, bytes / elapsed / 1e6);
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include "tracer.h"
+#include <QFile>
+#include <QThread>
+#include <QTextStream>
+
+// keeps a runaway trace from eating all memory, roughly 64 MiB of events
+const size_t maxTraceEvents = 2000000;
+
+std::atomic<bool> Tracer::_enabled(false);
+
+Tracer *Tracer::instance()
+{
+    static Tracer tracer;
+    return &tracer;
+}
+
+bool Tracer::start(const QString &fname)
+{
+    QMutexLocker lock(&_mutex);
+    if(enabled()) return false;
+
+    _fname = fname;
+    _events.clear();
+    _events.reserve(65536);
+    _dropped = 0;
+    _timer.start();
+    _enabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+bool Tracer::stop()
+{
+    QMutexLocker lock(&_mutex);
+    if(!enabled()) return false;
+    _enabled.store(false, std::memory_order_relaxed);
+
+    QFile file(_fname);
+    if(!file.open(QIODevice::WriteOnly | QFile::Truncate | QIODevice::Text))
+    {
+        _errorString = file.errorString();
+        _events.clear();
+        _events.shrink_to_fit();
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":" << _dropped << "},\"traceEvents\":[";
+    for(size_t i = 0; i < _events.size(); i++)
+    {
+        const Event &e = _events[i];
+        if(i > 0) out << ",\n";
+        out << "{\"name\":\"" << e.name << "\",\"cat\":\"canalizer\",\"ph\":\"" << e.phase
+            << "\",\"pid\":1,\"tid\":" << e.tid
+            << ",\"ts\":" << QString::number(e.ts / 1000.0, 'f', 3);
+        if(e.phase == 'X')
+            out << ",\"dur\":" << QString::number(e.dur / 1000.0, 'f', 3);
+        else if(e.phase == 'C')
+            out << ",\"args\":{\"value\":" << e.dur << "}";
+        out << "}";
+    }
+    out << "]}" << endl;
+    file.close();
+
+    _events.clear();
+    _events.shrink_to_fit();
+    if((out.status() != QTextStream::Ok) || (file.error() != QFileDevice::NoError))
+    {
+        _errorString = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void Tracer::complete(const char *name, qint64 start)
+{
+    record({ name, 'X', 0, start, now() - start });
+}
+
+void Tracer::begin(const char *name)
+{
+    if(!enabled()) return;
+    record({ name, 'B', 0, now(), 0 });
+}
+
+void Tracer::end(const char *name)
+{
+    if(!enabled()) return;
+    record({ name, 'E', 0, now(), 0 });
+}
+
+void Tracer::counter(const char *name, qint64 value)
+{
+    if(!enabled()) return;
+    record({ name, 'C', 0, now(), value });
+}
+
+void Tracer::record(const Event &event)
+{
+    Event e = event;
+    e.tid = reinterpret_cast<quintptr>(QThread::currentThreadId());
+
+    QMutexLocker lock(&_mutex);
+    // tracing stopped while a scope was open
+    if(!enabled()) return;
+    if(_events.size() >= maxTraceEvents)
+    {
+        _dropped++;
+        return;
+    }
+    _events.push_back(e);
+}
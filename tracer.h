@@ -0,0 +1,67 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <vector>
+
+// Chrome trace-event recorder, open the output in chrome://tracing or Perfetto.
+// Probes cost a single relaxed load while tracing is off.
+class Tracer
+{
+public:
+    static Tracer *instance();
+    static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+    bool start(const QString &fname);
+    bool stop();
+    bool running() const { return enabled(); }
+    QString errorString() const { return _errorString; }
+
+    qint64 now() const { return _timer.nsecsElapsed(); }
+    void complete(const char *name, qint64 start);
+    void begin(const char *name);
+    void end(const char *name);
+    void counter(const char *name, qint64 value);
+
+protected:
+    struct Event
+    {
+        const char *name;
+        char phase;
+        quint64 tid;
+        qint64 ts;
+        qint64 dur;
+    };
+
+    Tracer() {}
+    void record(const Event &event);
+
+    static std::atomic<bool> _enabled;
+    QMutex _mutex;
+    std::vector<Event> _events;
+    quint64 _dropped = 0;
+    QString _fname;
+    QString _errorString;
+    QElapsedTimer _timer;
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : _name(name), _start(Tracer::enabled() ? Tracer::instance()->now() : -1) {}
+    ~TraceScope() { if(_start >= 0) Tracer::instance()->complete(_name, _start); }
+
+private:
+    const char *_name;
+    qint64 _start;
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(_traceScope, __LINE__)(name)
+
+#endif // TRACER_H